@@ -0,0 +1,162 @@
+#!/bin/bash
+# SentinelFS Backup Interference Benchmark
+# Measures foreground I/O latency while a burst of backups runs, once per
+# backup I/O setting (rate limit, I/O priority class, page cache policy).
+#
+# The foreground job is fio doing 4KB O_DIRECT random reads on the storage
+# filesystem itself, next to the mount: it sees the disk exactly as the
+# backup workers leave it, without FUSE overhead blurring the numbers.
+# The burst is one 4KB write at offset 0 to each of BURST_FILES files
+# through the mount, each of which starts a full backup.
+#
+# Mounts and unmounts SentinelFS itself, once per setting. Run as root for
+# meaningful page cache numbers (caches are dropped before each run).
+
+set -e
+
+# Colors
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+# Test configuration
+SENTINELFS="${SENTINELFS:-../sentinelfs}"
+MOUNT_POINT="/tmp/sentinelfs_bench_mount"
+STORAGE_PATH="${STORAGE_PATH:-/tmp/sentinelfs_bench_storage}"
+BURST_FILES="${BURST_FILES:-64}"
+FILE_MB="${FILE_MB:-32}"
+RUNTIME=30                       # fio seconds; the burst starts after WARMUP
+WARMUP=5
+# -o settings compared: "cache:rate_mb:ioprio"
+SETTINGS="${SETTINGS:-keep:0:none drop:0:be drop:50:be direct:50:idle}"
+
+echo "════════════════════════════════════════════════════════"
+echo "  SentinelFS Backup Interference Benchmark"
+echo "  Foreground latency during a burst of $BURST_FILES x ${FILE_MB}MB backups"
+echo "════════════════════════════════════════════════════════"
+echo ""
+
+if [ ! -x "$SENTINELFS" ]; then
+    echo -e "${RED}Error: $SENTINELFS not found, run make first${NC}"
+    exit 1
+fi
+
+for tool in fio python3; do
+    if ! command -v $tool &> /dev/null; then
+        echo -e "${RED}Error: $tool is not installed${NC}"
+        exit 1
+    fi
+done
+
+if mountpoint -q "$MOUNT_POINT" 2>/dev/null; then
+    echo -e "${RED}Error: $MOUNT_POINT is already mounted, unmount it first${NC}"
+    exit 1
+fi
+
+if [ "$(id -u)" -ne 0 ]; then
+    echo -e "${YELLOW}Not root: page caches are not dropped between runs${NC}"
+fi
+
+mkdir -p "$STORAGE_PATH" "$MOUNT_POINT"
+echo "Storage: $STORAGE_PATH ($(stat -f -c %T "$STORAGE_PATH"))"
+echo ""
+
+unmount() {
+    fusermount3 -u "$MOUNT_POINT" 2>/dev/null || fusermount -u "$MOUNT_POINT" 2>/dev/null ||
+        umount "$MOUNT_POINT"
+}
+
+drop_caches() {
+    sync
+    [ "$(id -u)" -eq 0 ] && echo 3 > /proc/sys/vm/drop_caches || true
+}
+
+cached_kb() {
+    awk '/^Cached:/ { print $2 }' /proc/meminfo
+}
+
+# p50, p99 and p99.9 completion latency (us) and IOPS from fio's JSON
+fio_summary() {
+    python3 -c '
+import json, sys
+job = json.load(open(sys.argv[1]))["jobs"][0]["read"]
+pct = job["clat_ns"]["percentile"]
+print("%.0f %.0f %.0f %.0f" % (pct["50.000000"] / 1000, pct["99.000000"] / 1000,
+                               pct["99.900000"] / 1000, job["iops"]))' "$1"
+}
+
+echo "Preparing $BURST_FILES files of ${FILE_MB}MB and the fio file..."
+for i in $(seq 1 "$BURST_FILES"); do
+    [ -f "$STORAGE_PATH/burst_$i.bin" ] ||
+        dd if=/dev/urandom of="$STORAGE_PATH/burst_$i.bin" bs=1M count="$FILE_MB" 2>/dev/null
+done
+fio --name=prepare --filename="$STORAGE_PATH/fio_fg.bin" --size=1G --rw=write --bs=1M \
+    --output=/dev/null
+echo ""
+
+declare -A RESULTS
+
+for setting in $SETTINGS; do
+    IFS=: read -r cache rate ioprio <<< "$setting"
+    echo "-----------------------------------"
+    echo "backup_cache=$cache backup_rate_mb=$rate backup_ioprio=$ioprio"
+    echo "-----------------------------------"
+
+    rm -rf "$STORAGE_PATH/.sentinelfs_backups"
+    "$SENTINELFS" "$STORAGE_PATH" "$MOUNT_POINT" \
+        -o backup_cache="$cache",backup_rate_mb="$rate",backup_ioprio="$ioprio" > /dev/null
+    sleep 1
+    drop_caches
+    cache_before=$(cached_kb)
+
+    fio --name=foreground --filename="$STORAGE_PATH/fio_fg.bin" --size=1G --rw=randread \
+        --bs=4k --direct=1 --ioengine=psync --runtime=$RUNTIME --time_based \
+        --output-format=json --output=/tmp/sentinelfs_fio.json &
+    fio_pid=$!
+
+    sleep $WARMUP
+    start=$(date +%s%N)
+    for i in $(seq 1 "$BURST_FILES"); do
+        dd if=/dev/zero of="$MOUNT_POINT/burst_$i.bin" bs=4k count=1 conv=notrunc 2>/dev/null
+    done
+    end=$(date +%s%N)
+    wait $fio_pid
+
+    burst_ms=$(echo "scale=1; ($end - $start) / 1000000" | bc)
+    cache_mb=$(( ($(cached_kb) - cache_before) / 1024 ))
+    read -r p50 p99 p999 iops <<< "$(fio_summary /tmp/sentinelfs_fio.json)"
+    RESULTS[$setting]="$p50 $p99 $p999 $iops $cache_mb $burst_ms"
+
+    printf "  fio randread: p50 %s us, p99 %s us, p99.9 %s us, %s IOPS\n" "$p50" "$p99" "$p999" "$iops"
+    printf "  page cache grew %s MB, burst of writes took %s ms\n" "$cache_mb" "$burst_ms"
+
+    unmount
+    echo ""
+done
+
+#======================================================================
+# Summary Table
+#======================================================================
+echo "════════════════════════════════════════════════════════"
+echo "  Foreground 4KB randread during the backup burst"
+echo "════════════════════════════════════════════════════════"
+echo ""
+printf "%-22s | %8s | %8s | %8s | %8s | %10s | %9s\n" \
+    "cache:rate:ioprio" "p50 us" "p99 us" "p99.9 us" "IOPS" "cache +MB" "burst ms"
+echo "-----------------------------------------------------------------------------------------"
+for setting in $SETTINGS; do
+    read -r p50 p99 p999 iops cache_mb burst_ms <<< "${RESULTS[$setting]}"
+    printf "%-22s | %8s | %8s | %8s | %8s | %10s | %9s\n" \
+        "$setting" "$p50" "$p99" "$p999" "$iops" "$cache_mb" "$burst_ms"
+done
+echo ""
+echo -e "${BLUE}keep:0:none is the behavior before backup I/O throttling${NC}"
+echo ""
+
+# Cleanup
+rm -rf "$STORAGE_PATH"/burst_*.bin "$STORAGE_PATH/fio_fg.bin" "$STORAGE_PATH/.sentinelfs_backups" \
+    /tmp/sentinelfs_fio.json
+
+echo -e "${GREEN}Benchmark Complete${NC}"
@@ -0,0 +1,131 @@
+#!/bin/bash
+# SentinelFS First-Write Latency Benchmark
+# Measures the JIT backup cost on the first write to an existing file, for
+# each backup copy method (reflink, copy_file_range, sendfile).
+#
+# Mounts and unmounts SentinelFS itself, once per method. Reflink needs a
+# storage path on btrfs or XFS (mkfs.xfs -m reflink=1) and is skipped elsewhere.
+
+set -e
+
+# Colors
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+# Test configuration
+SENTINELFS="${SENTINELFS:-../sentinelfs}"
+MOUNT_POINT="/tmp/sentinelfs_bench_mount"
+STORAGE_PATH="${STORAGE_PATH:-/tmp/sentinelfs_bench_storage}"
+SIZES_KB="4 64 1024 10240 51200"   # 4KB .. 50MB (JIT_BACKUP_MAX_SIZE)
+METHODS="reflink copy_file_range sendfile"
+TRIALS=5
+
+echo "════════════════════════════════════════════════════════"
+echo "  SentinelFS First-Write Latency Benchmark"
+echo "  JIT backup cost per copy method"
+echo "════════════════════════════════════════════════════════"
+echo ""
+
+if [ ! -x "$SENTINELFS" ]; then
+    echo -e "${RED}Error: $SENTINELFS not found, run make first${NC}"
+    exit 1
+fi
+
+if mountpoint -q "$MOUNT_POINT" 2>/dev/null; then
+    echo -e "${RED}Error: $MOUNT_POINT is already mounted, unmount it first${NC}"
+    exit 1
+fi
+
+mkdir -p "$STORAGE_PATH" "$MOUNT_POINT"
+echo "Storage: $STORAGE_PATH ($(stat -f -c %T "$STORAGE_PATH"))"
+
+# Probe reflink support on the storage filesystem
+touch "$STORAGE_PATH/.reflink_probe"
+if ! cp --reflink=always "$STORAGE_PATH/.reflink_probe" "$STORAGE_PATH/.reflink_probe2" 2>/dev/null; then
+    echo -e "${YELLOW}Storage filesystem has no reflink support, skipping reflink${NC}"
+    METHODS="copy_file_range sendfile"
+fi
+rm -f "$STORAGE_PATH/.reflink_probe" "$STORAGE_PATH/.reflink_probe2"
+echo ""
+
+unmount() {
+    fusermount3 -u "$MOUNT_POINT" 2>/dev/null || fusermount -u "$MOUNT_POINT" 2>/dev/null ||
+        umount "$MOUNT_POINT"
+}
+
+# Time one 4KB write into the file at the given block offset, in ms
+timed_write() {
+    local file=$1 seek=$2
+    local start end
+    start=$(date +%s%N)
+    dd if=/dev/zero of="$file" bs=4k count=1 seek="$seek" conv=notrunc 2>/dev/null
+    end=$(date +%s%N)
+    echo "scale=3; ($end - $start) / 1000000" | bc
+}
+
+declare -A RESULTS
+
+for method in $METHODS; do
+    echo "-----------------------------------"
+    echo "Method: $method"
+    echo "-----------------------------------"
+
+    "$SENTINELFS" "$STORAGE_PATH" "$MOUNT_POINT" -o backup_method="$method" > /dev/null
+    sleep 1
+
+    for kb in $SIZES_KB; do
+        first_total=0
+        plain_total=0
+
+        for i in $(seq 1 $TRIALS); do
+            rm -f "$STORAGE_PATH"/.sentinelfs_backups/*
+            dd if=/dev/zero of="$STORAGE_PATH/bench.bin" bs=1k count="$kb" 2>/dev/null
+            sync
+
+            # Offset 0 triggers the backup, offset 4KB is the same write without it
+            first=$(timed_write "$MOUNT_POINT/bench.bin" 0)
+            plain=$(timed_write "$MOUNT_POINT/bench.bin" 1)
+            first_total=$(echo "$first_total + $first" | bc)
+            plain_total=$(echo "$plain_total + $plain" | bc)
+        done
+
+        first_avg=$(echo "scale=3; $first_total / $TRIALS" | bc)
+        plain_avg=$(echo "scale=3; $plain_total / $TRIALS" | bc)
+        backup_ms=$(echo "scale=3; $first_avg - $plain_avg" | bc)
+        RESULTS[$method,$kb]=$backup_ms
+
+        printf "  %8s KB: first write %8s ms, plain write %8s ms, backup ~%8s ms\n" \
+            "$kb" "$first_avg" "$plain_avg" "$backup_ms"
+    done
+
+    unmount
+    echo ""
+done
+
+#======================================================================
+# Summary Table
+#======================================================================
+echo "════════════════════════════════════════════════════════"
+echo "  Backup cost on first write (ms, first - plain write)"
+echo "════════════════════════════════════════════════════════"
+echo ""
+printf "%-12s" "Size (KB)"
+for method in $METHODS; do printf " | %-16s" "$method"; done
+echo ""
+echo "-------------------------------------------------------------"
+for kb in $SIZES_KB; do
+    printf "%-12s" "$kb"
+    for method in $METHODS; do printf " | %-16s" "${RESULTS[$method,$kb]}"; done
+    echo ""
+done
+echo ""
+echo -e "${BLUE}Previous stdio copy (8KB fread/fwrite): ~19.31 ms at 50MB${NC}"
+echo ""
+
+# Cleanup
+rm -f "$STORAGE_PATH/bench.bin" "$STORAGE_PATH"/.sentinelfs_backups/*
+
+echo -e "${GREEN}Benchmark Complete${NC}"
@@ -0,0 +1,132 @@
+#!/bin/bash
+# SentinelFS Time-to-Detect Benchmark
+# Runs sentinelfs-encryptor, a synthetic ransomware that XORs every file of
+# a test tree in place, against a fresh mount once per attack setting, and
+# reports how long SentinelFS took to step in and how much was lost first.
+#
+# A setting is "threads:files_per_sec:mb_per_sec" (0 = unpaced): a fast
+# smash-and-grab, a many-threaded one and slow, paced ones that try to stay
+# under the per-process file rate. "Lost" is verified by reading every file
+# back, so writes that were refused, staged or quarantined do not count.
+#
+# Mounts and unmounts SentinelFS itself; the tree is rebuilt between runs.
+
+set -e
+
+# Colors
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+# Test configuration
+SENTINELFS="${SENTINELFS:-../sentinelfs}"
+ENCRYPTOR="${ENCRYPTOR:-../sentinelfs-encryptor}"
+MOUNT_POINT="/tmp/sentinelfs_bench_mount"
+STORAGE_PATH="${STORAGE_PATH:-/tmp/sentinelfs_detect_storage}"
+PRISTINE="/tmp/sentinelfs_detect_tree"
+DIRS="${DIRS:-8}"
+FILES_PER_DIR="${FILES_PER_DIR:-50}"
+MOUNT_OPTS="${MOUNT_OPTS:-}"        # Extra -o options, e.g. canary_seed,quarantine
+SETTINGS="${SETTINGS:-1:0:0 8:0:0 1:20:0 1:5:2}"
+
+echo "════════════════════════════════════════════════════════"
+echo "  SentinelFS Time-to-Detect Benchmark"
+echo "  $DIRS directories x $FILES_PER_DIR files, encrypted in place"
+echo "════════════════════════════════════════════════════════"
+echo ""
+
+for bin in "$SENTINELFS" "$ENCRYPTOR"; do
+    if [ ! -x "$bin" ]; then
+        echo -e "${RED}Error: $bin not found, run make $(basename "$bin") first${NC}"
+        exit 1
+    fi
+done
+
+if mountpoint -q "$MOUNT_POINT" 2>/dev/null; then
+    echo -e "${RED}Error: $MOUNT_POINT is already mounted, unmount it first${NC}"
+    exit 1
+fi
+
+unmount() {
+    fusermount3 -u "$MOUNT_POINT" 2>/dev/null || fusermount -u "$MOUNT_POINT" 2>/dev/null ||
+        umount "$MOUNT_POINT"
+}
+
+# Text-like files, 4KB-256KB: notes, CSV tables and source-like listings
+echo "Preparing the test tree..."
+rm -rf "$PRISTINE"
+for d in $(seq 1 "$DIRS"); do
+    mkdir -p "$PRISTINE/dir_$d"
+    for i in $(seq 1 "$FILES_PER_DIR"); do
+        size=$(( (RANDOM % 64 + 1) * 4096 ))
+        case $((i % 3)) in
+            0) base64 /dev/urandom | head -c "$size" > "$PRISTINE/dir_$d/note_$i.txt" ;;
+            1) seq -f "%g,item $RANDOM,%g.50" 1 100000 | head -c "$size" > "$PRISTINE/dir_$d/table_$i.csv" ;;
+            2) yes "    value = compute(value, $i);  // step $d" | head -c "$size" > "$PRISTINE/dir_$d/code_$i.c" ;;
+        esac
+    done
+done
+echo "  $(find "$PRISTINE" -type f | wc -l) files, $(du -sh "$PRISTINE" | cut -f1)"
+echo ""
+
+declare -A RESULTS
+
+for setting in $SETTINGS; do
+    IFS=: read -r threads fps mbps <<< "$setting"
+    echo "-----------------------------------"
+    echo "threads=$threads files/s=$fps MB/s=$mbps"
+    echo "-----------------------------------"
+
+    rm -rf "$STORAGE_PATH"
+    mkdir -p "$STORAGE_PATH" "$MOUNT_POINT"
+    cp -a "$PRISTINE" "$STORAGE_PATH/tree"
+    "$SENTINELFS" "$STORAGE_PATH" "$MOUNT_POINT" ${MOUNT_OPTS:+-o "$MOUNT_OPTS"} > /dev/null 2>&1
+    sleep 1
+
+    "$ENCRYPTOR" -j "$threads" -f "$fps" -b "$mbps" -e .locked -m "$MOUNT_POINT" "$MOUNT_POINT/tree" \
+        > /tmp/sentinelfs_encryptor.out
+    sed 's/^/  /' /tmp/sentinelfs_encryptor.out
+
+    out=/tmp/sentinelfs_encryptor.out
+    block=$(awk '/^First block:/ { print ($3 == "never") ? "never" : $3 }' "$out")
+    lost=$(awk '/^Lost before block:/ { print $4 }' "$out")
+    lost_mb=$(awk '/^Lost before block:/ { print $6 }' "$out")
+    missed=$(awk '/^Lost after block:/ { print $4 }' "$out")
+    saved=$(awk '/^Saved:/ { print $2 "/" $4 }' "$out")
+    rate=$(awk '/^Elapsed:/ { print $3 }' "$out")
+    flag=$(awk '/^SentinelFS view:/ && /flagged [0-9]/ { for (i = 1; i < NF; i++) if ($i == "flagged") print $(i + 1) }' "$out")
+    RESULTS[$setting]="$block ${flag:--} $lost $lost_mb $missed $saved $rate"
+
+    unmount
+    echo ""
+done
+
+#======================================================================
+# Summary Table
+#======================================================================
+echo "════════════════════════════════════════════════════════"
+echo "  Data lost before SentinelFS stepped in"
+echo "════════════════════════════════════════════════════════"
+echo ""
+printf "%-12s | %9s | %9s | %10s | %9s | %10s | %9s | %8s\n" \
+    "thr:f/s:MB/s" "blocked" "flagged" "lost files" "lost MB" "lost after" "saved" "MB/s"
+echo "--------------------------------------------------------------------------------------------------"
+for setting in $SETTINGS; do
+    read -r block flag lost lost_mb missed saved rate <<< "${RESULTS[$setting]}"
+    printf "%-12s | %9s | %9s | %10s | %9s | %10s | %9s | %8s\n" \
+        "$setting" "$block" "$flag" "$lost" "$lost_mb" "$missed" "$saved" "$rate"
+done
+echo ""
+echo -e "${BLUE}blocked: first refused operation seen by the encryptor; flagged: SentinelFS's"
+echo -e "per-process flag, measured from the process's first operation${NC}"
+if [ -z "$MOUNT_OPTS" ]; then
+    echo -e "${YELLOW}Try MOUNT_OPTS=canary_seed or MOUNT_OPTS=quarantine to compare defenses${NC}"
+fi
+echo ""
+
+# Cleanup
+rm -rf "$STORAGE_PATH" "$PRISTINE" /tmp/sentinelfs_encryptor.out
+
+echo -e "${GREEN}Benchmark Complete${NC}"
@@ -0,0 +1,603 @@
+/*
+ * SentinelFS - JIT backup engine
+ *
+ * A backup in flight is a job with a per-chunk "saved" map. A writer about
+ * to overwrite a chunk first copies it into the job's sparse staging file;
+ * the worker streams the file into the chunk store in order, reading each
+ * chunk from staging if a writer saved it, otherwise from the source, and
+ * marks it. Both happen under the job lock, so every chunk is captured
+ * exactly once, before the first write to it lands. Writes only take the
+ * pool lock when some backup is actually pending.
+ */
+
+#define _GNU_SOURCE  // copy_file_range()
+
+#include "backup.h"
+#include "backup_gc.h"
+#include "backup_index.h"
+#include "backup_io.h"
+#include "chunk_store.h"
+#include "inode_table.h"
+#include "journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/fs.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <time.h>
+#include <unistd.h>
+
+const char *backup_method_names[] = { "auto", "reflink", "copy_file_range", "sendfile" };
+
+typedef struct backup_job {
+    dev_t dev;
+    ino_t ino;
+    struct stat st;          // As of the claim, for the index
+    uint64_t version;
+    int64_t time;            // Wall clock of the claim: when the pre-image was taken
+    int src, dst;            // dst: staging file, chunks saved on the write path
+    off_t size;
+    size_t nchunks;
+    unsigned char *saved;    // Per chunk: captured, in staging or the chunk store
+    pthread_mutex_t lock;    // Held while a chunk is copied
+    backup_method_t used;    // How chunks were staged, AUTO if none were
+    int no_copy_range;       // copy_file_range failed once, use sendfile
+    int failed;
+    int started;             // Picked up by a worker, or copied inline
+    int copy_inline;         // Queue was full: the claiming writer copies it all
+    int refs;                // Under pool.lock
+    struct backup_job *next; // In-flight list
+    char source_path[PATH_MAX];
+    char backup_path[PATH_MAX];   // Manifest
+    char staging_path[PATH_MAX];
+} backup_job_t;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;     // Job queued, or shutting down
+    backup_job_t *jobs;      // In flight, by inode
+    size_t queued;           // Jobs waiting for or running on a worker
+    int stop;
+    pthread_t workers[BACKUP_WORKERS];
+    int nworkers;
+} pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, 0, 0, {0}, 0 };
+
+static _Atomic size_t jobs_pending;  // Lock-free "anything in flight?" check for writes
+
+// Per-inode backup state: when the current protection window ends
+typedef struct {
+    int64_t expires;     // CLOCK_MONOTONIC seconds, 0 = never backed up
+    int64_t truncated;   // Window end after the file was last cut short, 0 = never
+    journal_t *journal;  // Pre-image journal, for files over JIT_BACKUP_MAX_SIZE
+} backup_state_t;
+
+static inode_table_t *backup_table = NULL;
+static unsigned backup_window;
+
+static const char *backup_dir;
+static backup_method_t backup_method;
+
+static struct {
+    _Atomic unsigned long created;
+    _Atomic unsigned long by_method[4];  // Indexed by backup_method_t
+    _Atomic unsigned long failed;
+    _Atomic unsigned long deferred;      // Finished by a worker
+    _Atomic unsigned long redundant;     // Offset-0 rewrites inside the window, not re-backed up
+    _Atomic unsigned long journals;      // Large files protected by a pre-image journal
+    _Atomic unsigned long linked;        // Removed files kept by a hard link into the store
+    _Atomic unsigned long long journal_bytes;
+    _Atomic unsigned long long sync_bytes;   // Staged on the write path
+    _Atomic unsigned long long async_bytes;  // Read from the source by workers
+} bstats;
+
+// Generate backup filename: the version keeps it unique, the basename
+// only helps a human browsing the directory
+static void get_backup_path(const char *original_path, uint64_t version, const char *suffix,
+                            char *backup_path) {
+    const char *basename = strrchr(original_path, '/');
+    basename = basename ? basename + 1 : original_path;
+
+    snprintf(backup_path, PATH_MAX, "%s/%s.%llu.%s", backup_dir, basename,
+             (unsigned long long)version, suffix);
+}
+
+static void index_backup(uint32_t kind, uint64_t version, const struct stat *st, int64_t time,
+                         const char *source_path, const char *backup_path) {
+    backup_index_append(kind, version, st, time, source_path, strrchr(backup_path, '/') + 1);
+}
+
+// In-kernel copies at an explicit offset, no user-space buffer
+static int copy_range_at(int src, int dst, off_t off, size_t len) {
+    loff_t in = off, out = off;
+    while (len > 0) {
+        ssize_t n = copy_file_range(src, &in, dst, &out, len, 0);
+        if (n == -1) return -1;
+        if (n == 0) break;  // File shrank under us
+        len -= n;
+    }
+    return 0;
+}
+
+static int sendfile_at(int src, int dst, off_t off, size_t len) {
+    if (lseek(dst, off, SEEK_SET) == -1) return -1;
+    while (len > 0) {
+        ssize_t n = sendfile(dst, src, &off, len);
+        if (n == -1) return -1;
+        if (n == 0) break;
+        len -= n;
+    }
+    return 0;
+}
+
+// Caller holds job->lock
+static int copy_chunk(backup_job_t *job, size_t c) {
+    off_t off = (off_t)c * BACKUP_CHUNK;
+    size_t len = job->size - off < BACKUP_CHUNK ? (size_t)(job->size - off) : BACKUP_CHUNK;
+
+    if ((backup_method == BACKUP_AUTO || backup_method == BACKUP_COPY_RANGE) && !job->no_copy_range) {
+        if (copy_range_at(job->src, job->dst, off, len) == 0) {
+            job->used = BACKUP_COPY_RANGE;
+            return 0;
+        }
+        if (backup_method == BACKUP_COPY_RANGE) return -1;
+        job->no_copy_range = 1;
+    }
+    if (backup_method != BACKUP_CLONE && sendfile_at(job->src, job->dst, off, len) == 0) {
+        job->used = BACKUP_SENDFILE;
+        return 0;
+    }
+    return -1;
+}
+
+// Make sure every chunk overlapping [offset, offset + len) is captured
+static void save_range(backup_job_t *job, off_t offset, off_t len, int on_write_path) {
+    if (offset >= job->size || len <= 0) return;
+    off_t end = offset + len < job->size ? offset + len : job->size;
+
+    for (size_t c = offset / BACKUP_CHUNK; c <= (size_t)((end - 1) / BACKUP_CHUNK); c++) {
+        pthread_mutex_lock(&job->lock);
+        if (!job->saved[c]) {
+            if (copy_chunk(job, c) != 0) job->failed = 1;
+            job->saved[c] = 1;  // Even on failure: writes must not wait forever
+
+            off_t bytes = job->size - (off_t)c * BACKUP_CHUNK;
+            if (bytes > BACKUP_CHUNK) bytes = BACKUP_CHUNK;
+            atomic_fetch_add_explicit(on_write_path ? &bstats.sync_bytes : &bstats.async_bytes,
+                                      bytes, memory_order_relaxed);
+        }
+        pthread_mutex_unlock(&job->lock);
+    }
+}
+
+static ssize_t pread_full(int fd, unsigned char *buf, size_t len, off_t off) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, buf + done, len - done, off + done);
+        if (n == -1) return -1;
+        if (n == 0) break;
+        done += n;
+    }
+    return done;
+}
+
+// Stream the whole original into the chunk store. A chunk a writer has
+// saved comes from staging; any other is read from the source under the
+// job lock and marked, so no writer can change it mid-read.
+static void store_backup(backup_job_t *job, int on_write_path) {
+    backup_gc_hold();  // Until the manifest is indexed
+    unsigned char *buf = malloc(BACKUP_CHUNK);
+    // Compression is background work only: not when the writer copies inline
+    chunk_writer_t *w = chunk_writer_open(job->backup_path, job->source_path, job->size,
+                                          !on_write_path);
+    if (!buf || !w) job->failed = 1;
+
+    for (size_t c = 0; c < job->nchunks && !job->failed; c++) {
+        off_t off = (off_t)c * BACKUP_CHUNK;
+        size_t len = job->size - off < BACKUP_CHUNK ? (size_t)(job->size - off) : BACKUP_CHUNK;
+        ssize_t n;
+
+        // Workers only, and never under the job lock: a writer that needs
+        // this chunk meanwhile copies it itself
+        if (!on_write_path) backup_io_throttle(len);
+
+        pthread_mutex_lock(&job->lock);
+        int staged = job->saved[c];
+        if (!staged) {
+            n = pread_full(job->src, buf, len, off);
+            job->saved[c] = 1;
+            atomic_fetch_add_explicit(on_write_path ? &bstats.sync_bytes : &bstats.async_bytes,
+                                      len, memory_order_relaxed);
+        }
+        pthread_mutex_unlock(&job->lock);
+
+        if (staged) n = pread_full(job->dst, buf, len, off);
+        if (n != (ssize_t)len || chunk_writer_add(w, buf, len) != 0) job->failed = 1;
+    }
+
+    if (w && chunk_writer_close(w, job->failed) != 0) job->failed = 1;
+    if (!job->failed) {
+        index_backup(INDEX_MANIFEST, job->version, &job->st, job->time, job->source_path,
+                     job->backup_path);
+    }
+    backup_gc_release();
+    free(buf);
+}
+
+static void finish_job(backup_job_t *job) {
+    unlink(job->staging_path);
+    if (job->failed) {
+        atomic_fetch_add_explicit(&bstats.failed, 1, memory_order_relaxed);
+        fprintf(stderr, "[SentinelFS] Backup failed: %s\n", job->source_path);
+        return;
+    }
+
+    atomic_fetch_add_explicit(&bstats.created, 1, memory_order_relaxed);
+    if (job->used != BACKUP_AUTO) {
+        atomic_fetch_add_explicit(&bstats.by_method[job->used], 1, memory_order_relaxed);
+    }
+    fprintf(stderr, "[SentinelFS] JIT Backup created: %s -> %s\n", job->source_path, job->backup_path);
+}
+
+static void free_job(backup_job_t *job) {
+    close(job->src);
+    close(job->dst);
+    pthread_mutex_destroy(&job->lock);
+    free(job->saved);
+    free(job);
+}
+
+// Caller holds pool.lock
+static void put_job(backup_job_t *job) {
+    if (--job->refs == 0) free_job(job);
+}
+
+// Caller holds pool.lock
+static backup_job_t *find_job(dev_t dev, ino_t ino) {
+    for (backup_job_t *j = pool.jobs; j; j = j->next) {
+        if (j->dev == dev && j->ino == ino) return j;
+    }
+    return NULL;
+}
+
+// Caller holds pool.lock
+static void unlink_job(backup_job_t *job) {
+    for (backup_job_t **p = &pool.jobs; *p; p = &(*p)->next) {
+        if (*p == job) {
+            *p = job->next;
+            break;
+        }
+    }
+    atomic_fetch_sub_explicit(&jobs_pending, 1, memory_order_release);
+    put_job(job);
+}
+
+static backup_job_t *get_pending_job(const struct stat *st) {
+    if (atomic_load_explicit(&jobs_pending, memory_order_acquire) == 0) return NULL;
+
+    pthread_mutex_lock(&pool.lock);
+    backup_job_t *job = find_job(st->st_dev, st->st_ino);
+    if (job) job->refs++;
+    pthread_mutex_unlock(&pool.lock);
+    return job;
+}
+
+static void release_job(backup_job_t *job) {
+    pthread_mutex_lock(&pool.lock);
+    put_job(job);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+static void *backup_worker(void *arg) {
+    (void) arg;
+    backup_io_thread();
+
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        backup_job_t *job = pool.jobs;
+        while (job && job->started) job = job->next;
+        if (!job) {
+            if (pool.stop) break;
+            pthread_cond_wait(&pool.wake, &pool.lock);
+            continue;
+        }
+
+        job->started = 1;
+        pthread_mutex_unlock(&pool.lock);
+
+        store_backup(job, 0);
+        finish_job(job);
+        atomic_fetch_add_explicit(&bstats.deferred, 1, memory_order_relaxed);
+
+        pthread_mutex_lock(&pool.lock);
+        pool.queued--;
+        unlink_job(job);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+// Evicted or forgotten inode: a later write simply starts a new window
+static void drop_state(void *value) {
+    backup_state_t *s = value;
+    journal_close(s->journal);
+    s->journal = NULL;
+}
+
+int backup_init(const char *dir, backup_method_t method, unsigned window, size_t max_files,
+                int compress) {
+    backup_dir = dir;
+    backup_method = method;
+    backup_window = window;
+
+    if (chunk_store_init(dir, compress) != 0 || backup_index_open(dir) != 0) return -1;
+    backup_table = inode_table_create(max_files, sizeof(backup_state_t), drop_state);
+    if (!backup_table) return -1;
+
+    for (int i = 0; i < BACKUP_WORKERS; i++) {
+        if (pthread_create(&pool.workers[i], NULL, backup_worker, NULL) != 0) {
+            backup_shutdown();
+            return -1;
+        }
+        pool.nworkers++;
+    }
+    return 0;
+}
+
+void backup_shutdown(void) {
+    backup_io_unthrottle();  // Drain the queue at full speed
+    pthread_mutex_lock(&pool.lock);
+    pool.stop = 1;
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.lock);
+
+    for (int i = 0; i < pool.nworkers; i++) {
+        pthread_join(pool.workers[i], NULL);
+    }
+    pool.nworkers = 0;
+
+    inode_table_destroy(backup_table);
+    backup_table = NULL;
+    backup_index_close();
+}
+
+// Open the staging file, reflink the original into it if possible, and
+// register a job to chunk it. Returns the job with a reference for the
+// caller, or NULL on failure.
+static backup_job_t *begin_backup(const char *source_path, const struct stat *st) {
+    backup_job_t *job = calloc(1, sizeof(*job));
+    if (!job) return NULL;
+    job->dev = st->st_dev;
+    job->ino = st->st_ino;
+    job->st = *st;
+    job->version = backup_index_next_version();
+    job->time = time(NULL);
+    job->size = st->st_size;
+    job->nchunks = (st->st_size + BACKUP_CHUNK - 1) / BACKUP_CHUNK;
+    job->refs = 1;
+    snprintf(job->source_path, sizeof(job->source_path), "%s", source_path);
+    get_backup_path(source_path, job->version, "manifest", job->backup_path);
+    get_backup_path(source_path, job->version, "staging", job->staging_path);
+    pthread_mutex_init(&job->lock, NULL);
+
+    job->saved = calloc(job->nchunks, 1);
+    job->src = open(source_path, O_RDONLY);
+    job->dst = open(job->staging_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (!job->saved || job->src == -1 || job->dst == -1) {
+        fprintf(stderr, "[SentinelFS] Backup failed (%s): %s\n", strerror(errno), source_path);
+        if (job->dst != -1) unlink(job->staging_path);
+        free_job(job);
+        return NULL;
+    }
+    backup_io_reading(job->src);
+
+    // Reflink: O(1), staging shares extents with the original (btrfs, XFS),
+    // so every chunk is saved before any write and writers never copy
+    if (backup_method == BACKUP_AUTO || backup_method == BACKUP_CLONE) {
+        if (ioctl(job->dst, FICLONE, job->src) == 0) {
+            job->used = BACKUP_CLONE;
+            memset(job->saved, 1, job->nchunks);
+        } else if (backup_method == BACKUP_CLONE) {
+            job->failed = 1;
+            finish_job(job);
+            free_job(job);
+            return NULL;
+        }
+    }
+
+    // Registered either way, so other writers to the file find it. With the
+    // queue full (or no workers) the caller copies it inline, as before.
+    pthread_mutex_lock(&pool.lock);
+    job->refs++;  // The list's reference
+    job->next = pool.jobs;
+    pool.jobs = job;
+    atomic_fetch_add_explicit(&jobs_pending, 1, memory_order_release);
+    if (pool.queued < BACKUP_QUEUE_MAX && pool.nworkers > 0) {
+        pool.queued++;
+        pthread_cond_signal(&pool.wake);
+    } else {
+        job->started = 1;
+        job->copy_inline = 1;
+    }
+    pthread_mutex_unlock(&pool.lock);
+
+    return job;
+}
+
+static journal_t *start_journal(const char *source_path, const struct stat *st) {
+    char path[PATH_MAX];
+    uint64_t version = backup_index_next_version();
+    get_backup_path(source_path, version, "journal", path);
+
+    journal_t *j = journal_create(path, source_path, st->st_size);
+    if (!j) {
+        fprintf(stderr, "[SentinelFS] Journal failed (%s): %s\n", strerror(errno), source_path);
+        return NULL;
+    }
+    // Indexed up front: the journal grows with every first overwrite
+    index_backup(INDEX_JOURNAL, version, st, time(NULL), source_path, path);
+    atomic_fetch_add_explicit(&bstats.journals, 1, memory_order_relaxed);
+    fprintf(stderr, "[SentinelFS] Pre-image journal started: %s -> %s\n", source_path, path);
+    return j;
+}
+
+// Caller holds the inode's set lock
+static void journal_range(backup_state_t *s, const char *source_path, off_t offset, off_t len) {
+    long long n = journal_save(s->journal, source_path, offset, len);
+    if (n > 0) atomic_fetch_add_explicit(&bstats.journal_bytes, n, memory_order_relaxed);
+}
+
+static int64_t now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+// Claim the backup of this inode for the current protection window. Files
+// over JIT_BACKUP_MAX_SIZE get a pre-image journal instead of a copy; it is
+// extended here, under the set lock that serializes access to it.
+static backup_job_t *claim_backup(const char *source_path, const struct stat *st, off_t offset,
+                                  size_t len, int *claimed) {
+    int64_t now = now_sec();
+    backup_job_t *job = NULL;
+
+    backup_state_t *s = inode_table_get(backup_table, st->st_dev, st->st_ino, 1, NULL);
+    if (!s) return NULL;
+
+    if (s->expires <= now) {
+        // Job registered under the set lock, so a concurrent writer that
+        // sees the claim also finds the job
+        drop_state(s);
+        if (st->st_size > JIT_BACKUP_MAX_SIZE) {
+            s->journal = start_journal(source_path, st);
+        } else {
+            job = begin_backup(source_path, st);
+            *claimed = job != NULL;
+        }
+        // Only a backup that exists covers the window: after a failure the
+        // next write (or removal) tries again
+        if (s->journal || job) s->expires = now + backup_window;
+    } else {
+        if (offset == 0) atomic_fetch_add_explicit(&bstats.redundant, 1, memory_order_relaxed);
+        if (!s->journal) job = get_pending_job(st);  // Claimed by a concurrent writer, maybe still copying
+    }
+
+    if (s->journal) journal_range(s, source_path, offset, len);
+
+    inode_table_put(backup_table, s);
+    return job;
+}
+
+void backup_before_write(const char *source_path, const struct stat *st,
+                         off_t offset, size_t len) {
+    // A pure append overwrites nothing: no pre-image to take, and a log
+    // file must not cost a full backup every window
+    if (offset >= st->st_size) return;
+
+    backup_job_t *job = get_pending_job(st);
+    int claimed = 0;
+    if (!job && st->st_size > 0) {
+        job = claim_backup(source_path, st, offset, len, &claimed);
+    }
+    if (!job) return;
+
+    save_range(job, offset, len, 1);
+
+    if (claimed && job->copy_inline) {
+        store_backup(job, 1);
+        finish_job(job);
+        pthread_mutex_lock(&pool.lock);
+        unlink_job(job);
+        pthread_mutex_unlock(&pool.lock);
+    }
+    release_job(job);
+}
+
+void backup_before_truncate(const char *source_path, const struct stat *st, off_t size) {
+    // The tail about to be cut off is overwritten as far as the backup is
+    // concerned: claimed like a write, so with reflink it costs no copy
+    if (size < st->st_size) {
+        backup_before_write(source_path, st, size, st->st_size - size);
+
+        // Writes past the new end now replace data: see backup_truncated()
+        backup_state_t *s = inode_table_get(backup_table, st->st_dev, st->st_ino, 1, NULL);
+        if (s) {
+            s->truncated = now_sec() + backup_window;
+            inode_table_put(backup_table, s);
+        }
+    }
+}
+
+int backup_truncated(const struct stat *st) {
+    if (!backup_table) return 0;
+
+    backup_state_t *s = inode_table_get(backup_table, st->st_dev, st->st_ino, 0, NULL);
+    if (!s) return 0;
+    int cut = s->truncated > now_sec();
+    inode_table_put(backup_table, s);
+    return cut;
+}
+
+uint64_t backup_before_remove(const char *source_path, const struct stat *st) {
+    if (!S_ISREG(st->st_mode) || st->st_nlink != 1 || st->st_size == 0) return 0;
+
+    // Already backed up in this window. A journaled file is not: its
+    // journals are relative to the file itself.
+    backup_state_t *s = inode_table_get(backup_table, st->st_dev, st->st_ino, 0, NULL);
+    if (s) {
+        int covered = s->expires > now_sec() && !s->journal;
+        inode_table_put(backup_table, s);
+        if (covered) return 0;
+    }
+
+    char path[PATH_MAX];
+    uint64_t version = backup_index_next_version();
+    get_backup_path(source_path, version, "preimage", path);
+    if (link(source_path, path) == -1) {
+        atomic_fetch_add_explicit(&bstats.failed, 1, memory_order_relaxed);
+        fprintf(stderr, "[SentinelFS] Pre-image link failed (%s): %s\n", strerror(errno), source_path);
+        return 0;
+    }
+    return version;
+}
+
+void backup_after_remove(const char *source_path, const struct stat *st, uint64_t version, int res) {
+    char path[PATH_MAX];
+    if (version) get_backup_path(source_path, version, "preimage", path);
+
+    if (res != 0) {
+        if (version) unlink(path);
+        return;
+    }
+
+    if (version) {
+        index_backup(INDEX_PREIMAGE, version, st, time(NULL), source_path, path);
+        atomic_fetch_add_explicit(&bstats.linked, 1, memory_order_relaxed);
+        fprintf(stderr, "[SentinelFS] Pre-image kept: %s -> %s\n", source_path, path);
+    }
+
+    // Last link gone, the inode number may be reused
+    if (!S_ISREG(st->st_mode) || st->st_nlink != 1) return;
+    backup_state_t *s = inode_table_get(backup_table, st->st_dev, st->st_ino, 0, NULL);
+    if (s) inode_table_remove(backup_table, s);
+}
+
+void backup_print_stats(FILE *out) {
+    fprintf(out, "  Backups created: %lu (staged by reflink %lu, copy_file_range %lu, sendfile %lu), failed: %lu\n",
+            atomic_load(&bstats.created), atomic_load(&bstats.by_method[BACKUP_CLONE]),
+            atomic_load(&bstats.by_method[BACKUP_COPY_RANGE]),
+            atomic_load(&bstats.by_method[BACKUP_SENDFILE]), atomic_load(&bstats.failed));
+    fprintf(out, "  Backups finished in background: %lu (staged on write path: %llu KB, read by workers: %llu KB)\n",
+            atomic_load(&bstats.deferred), atomic_load(&bstats.sync_bytes) / 1024,
+            atomic_load(&bstats.async_bytes) / 1024);
+    fprintf(out, "  Redundant backups avoided: %lu\n", atomic_load(&bstats.redundant));
+    fprintf(out, "  Pre-image journals: %lu (%llu KB journaled)\n", atomic_load(&bstats.journals),
+            atomic_load(&bstats.journal_bytes) / 1024);
+    fprintf(out, "  Removed files kept by hard link: %lu\n", atomic_load(&bstats.linked));
+    chunk_store_print_stats(out);
+}
@@ -0,0 +1,75 @@
+/*
+ * SentinelFS - JIT backup engine
+ *
+ * The first write to a file in each protection window backs it up into
+ * the deduplicating chunk store (chunk_store.h); per-inode state remembers
+ * which files are already covered, so rewrites within the window cost
+ * nothing. The write only waits until the data it is about to overwrite is
+ * safe: a reflink of the whole file where the filesystem supports it,
+ * otherwise a copy of just the chunks the write touches into a staging
+ * file. A pool of worker threads chunks the rest. Until a backup
+ * completes, every write or truncate of that file first saves the chunks
+ * it would destroy. Files over JIT_BACKUP_MAX_SIZE are protected by a
+ * block-level pre-image journal (journal.h) instead. A file that is
+ * unlinked or renamed over is kept whole by a hard link into the store.
+ */
+
+#ifndef SENTINELFS_BACKUP_H
+#define SENTINELFS_BACKUP_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define BACKUP_DIR ".sentinelfs_backups"        // Under the storage root
+#define JIT_BACKUP_MAX_SIZE (50 * 1024 * 1024)  // Larger files get a pre-image journal instead
+#define BACKUP_CHUNK (256 * 1024)               // Unit of copy-before-overwrite
+#define BACKUP_QUEUE_MAX 64                     // Backups in flight; beyond this, copy inline
+#define BACKUP_WORKERS 2
+#define BACKUP_WINDOW_DEFAULT 3600              // Seconds a backup covers a file
+#define BACKUP_MAX_FILES 16384                  // Inodes whose backup state is remembered
+
+// Backup copy methods (-o backup_method=), AUTO tries them cheapest first
+typedef enum {
+    BACKUP_AUTO = 0,
+    BACKUP_CLONE,       // ioctl(FICLONE) reflink
+    BACKUP_COPY_RANGE,  // copy_file_range()
+    BACKUP_SENDFILE     // sendfile()
+} backup_method_t;
+
+extern const char *backup_method_names[];
+
+// Start the worker pool; backups go to backup_dir. A file is backed up at
+// most once per window seconds, tracked for up to max_files inodes (the
+// least recently written are forgotten first, and simply backed up again).
+// With compress, workers store chunks zlib-compressed.
+int backup_init(const char *backup_dir, backup_method_t method, unsigned window,
+                size_t max_files, int compress);
+// Finish every queued backup, then stop the workers
+void backup_shutdown(void);
+
+// Call before writing [offset, offset + len) of source_path (st as of
+// before the write). Returns once the bytes being overwritten are backed up.
+// A pure append (offset at or past the end) overwrites nothing and is free.
+void backup_before_write(const char *source_path, const struct stat *st,
+                         off_t offset, size_t len);
+// Call before truncating the file to size (truncate(), O_TRUNC opens):
+// the tail being cut off is backed up like a write to it
+void backup_before_truncate(const char *source_path, const struct stat *st, off_t size);
+// Was the file cut short (truncate(), O_TRUNC) within its backup window? Its
+// "appends" then rewrite the data it held, so they are judged as overwrites.
+int backup_truncated(const struct stat *st);
+// Call before the last link to a file goes away (unlink, rename over it).
+// Unless the file is already backed up in this window, it is hard-linked
+// into the backup store, so no data is copied. Returns the version to pass
+// to backup_after_remove(), 0 if nothing was linked.
+uint64_t backup_before_remove(const char *source_path, const struct stat *st);
+// The unlink or rename returned res (0 or -errno): index the pre-image, or
+// drop it if the file is still there. On success the inode's state is
+// forgotten, so a file that later reuses the inode number gets its own backup.
+void backup_after_remove(const char *source_path, const struct stat *st, uint64_t version, int res);
+
+void backup_print_stats(FILE *out);
+
+#endif /* SENTINELFS_BACKUP_H */
@@ -0,0 +1,641 @@
+/*
+ * SentinelFS - Backup retention and garbage collection
+ *
+ * Everything here runs on the GC thread except hold/release. Versions sit
+ * in an array in index order (oldest first); chunk references are counted
+ * in a table keyed by the first 8 bytes of the chunk hash. Two chunks that
+ * share a key only make the count conservative: neither is unlinked until
+ * both are unreferenced.
+ */
+
+#include "backup_gc.h"
+#include "backup_index.h"
+#include "backup_io.h"
+#include "chunk_store.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+enum { GC_AGE, GC_VERSIONS, GC_QUOTA, GC_SIZE };
+
+// Open addressing, uint64 -> uint64, key 0 = empty
+typedef struct {
+    uint64_t *keys;
+    uint64_t *vals;
+    size_t mask;
+    size_t used;
+} u64map_t;
+
+typedef struct {
+    uint64_t version;
+    int64_t time;
+    uint64_t dev, ino, size;
+    uint32_t uid, mode, kind;
+    int live;
+    int holds_refs;       // Manifest was read: its chunks are counted
+    uint64_t file_bytes;  // The manifest or journal itself
+    uint64_t charge;      // What this version added to the store
+    uint32_t path;        // In gc.paths
+    int32_t next;         // Next newer version of the same path, -1 if none
+    char *name;
+} gc_version_t;
+
+typedef struct {
+    char *path;
+    int32_t oldest, newest;
+    uint32_t live;
+} gc_path_t;
+
+typedef struct {
+    uint32_t uid;
+    uint64_t bytes;
+} gc_uid_t;
+
+static struct {
+    backup_gc_policy_t policy;
+    char dir[PATH_MAX - 256];
+    pthread_t thread;
+    int enabled;                 // Some policy is set
+    int running;
+    _Atomic int stop;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int64_t next_op;             // Pacing, CLOCK_MONOTONIC ns
+
+    size_t index_off;            // Index bytes already ingested
+    gc_version_t *versions;
+    size_t nversions, versions_cap, oldest;
+    gc_path_t *paths;
+    size_t npaths, paths_cap;
+    gc_uid_t *uids;
+    size_t nuids;
+    u64map_t path_map, version_map, chunk_map;
+
+    unsigned char (*doomed)[SHA256_DIGEST_SIZE];  // Unreferenced chunks to unlink
+    size_t ndoomed, doomed_cap;
+
+    uint64_t chunk_bytes, file_bytes;
+} gc = { .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER };
+
+static pthread_rwlock_t hold_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static struct {
+    _Atomic unsigned long long store_bytes;
+    _Atomic unsigned long live;
+    _Atomic unsigned long removed[4];  // By policy
+    _Atomic unsigned long chunks_freed;
+    _Atomic unsigned long long bytes_freed;
+} gstats;
+
+static uint64_t *map_get(u64map_t *m, uint64_t key, int create) {
+    if (create && (m->used + 1) * 2 > m->mask + 1) {
+        size_t cap = m->mask ? 2 * (m->mask + 1) : 1024;
+        uint64_t *keys = calloc(cap, sizeof(uint64_t)), *vals = calloc(cap, sizeof(uint64_t));
+        if (!keys || !vals) {
+            free(keys);
+            free(vals);
+            return NULL;
+        }
+        for (size_t i = 0; m->mask && i <= m->mask; i++) {
+            if (!m->keys[i]) continue;
+            size_t j = (m->keys[i] * 0x9e3779b97f4a7c15ULL >> 17) & (cap - 1);
+            while (keys[j]) j = (j + 1) & (cap - 1);
+            keys[j] = m->keys[i];
+            vals[j] = m->vals[i];
+        }
+        free(m->keys);
+        free(m->vals);
+        m->keys = keys;
+        m->vals = vals;
+        m->mask = cap - 1;
+    }
+    if (!m->keys) return NULL;
+
+    size_t i = (key * 0x9e3779b97f4a7c15ULL >> 17) & m->mask;
+    while (m->keys[i] && m->keys[i] != key) i = (i + 1) & m->mask;
+    if (m->keys[i]) return &m->vals[i];
+    if (!create) return NULL;
+    m->keys[i] = key;
+    m->vals[i] = 0;
+    m->used++;
+    return &m->vals[i];
+}
+
+static uint64_t chunk_key(const unsigned char *hash) {
+    uint64_t key;
+    memcpy(&key, hash, sizeof(key));
+    return key ? key : 1;
+}
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// One unit of GC I/O: sleep as needed to stay under policy.rate per second
+static void pace(void) {
+    if (atomic_load_explicit(&gc.stop, memory_order_relaxed)) return;
+
+    int64_t now = now_ns();
+    if (gc.next_op < now) {
+        gc.next_op = now;
+    } else {
+        struct timespec ts = { (gc.next_op - now) / 1000000000LL, (gc.next_op - now) % 1000000000LL };
+        nanosleep(&ts, NULL);
+    }
+    gc.next_op += 1000000000LL / gc.policy.rate;
+}
+
+static int stopping(void) {
+    return atomic_load_explicit(&gc.stop, memory_order_relaxed);
+}
+
+static gc_uid_t *uid_usage(uint32_t uid) {
+    for (size_t i = 0; i < gc.nuids; i++) {
+        if (gc.uids[i].uid == uid) return &gc.uids[i];
+    }
+    gc_uid_t *u = realloc(gc.uids, (gc.nuids + 1) * sizeof(*u));
+    if (!u) return NULL;
+    gc.uids = u;
+    gc.uids[gc.nuids] = (gc_uid_t){ uid, 0 };
+    return &gc.uids[gc.nuids++];
+}
+
+static int64_t path_slot(const char *path) {
+    uint64_t h = 0xcbf29ce484222325ULL;  // FNV-1a; on a collision, probe the next key
+    for (const char *s = path; *s; s++) h = (h ^ (unsigned char)*s) * 0x100000001b3ULL;
+
+    for (;; h++) {
+        uint64_t *v = map_get(&gc.path_map, h ? h : 1, 1);
+        if (!v) return -1;
+        if (*v && strcmp(gc.paths[*v - 1].path, path) == 0) return *v - 1;
+        if (*v) continue;
+
+        if (gc.npaths == gc.paths_cap) {
+            size_t cap = gc.paths_cap ? 2 * gc.paths_cap : 256;
+            gc_path_t *p = realloc(gc.paths, cap * sizeof(*p));
+            if (!p) return -1;
+            gc.paths = p;
+            gc.paths_cap = cap;
+        }
+        gc.paths[gc.npaths] = (gc_path_t){ strdup(path), -1, -1, 0 };
+        *v = ++gc.npaths;
+        return gc.npaths - 1;
+    }
+}
+
+// Count the references of a manifest's chunks up (delta 1) or down (-1).
+// *added receives the bytes of chunks that were not referenced before.
+static int count_chunks(const gc_version_t *v, int delta, uint64_t *added) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", gc.dir, v->name);
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+
+    manifest_header_t h;
+    int ok = fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, MANIFEST_MAGIC, 8) == 0 &&
+             fseek(f, h.path_len, SEEK_CUR) == 0;
+
+    manifest_entry_t e;
+    *added = 0;
+    while (ok && fread(&e, sizeof(e), 1, f) == 1) {
+        uint64_t *val = map_get(&gc.chunk_map, chunk_key(e.hash), delta > 0);
+        if (!val || (delta < 0 && *val >> 32 == 0)) continue;
+        uint64_t refs = *val >> 32, size = *val & 0xffffffff;
+
+        if (delta > 0 && refs == 0) {
+            char cpath[PATH_MAX];
+            struct stat st;
+            chunk_path(e.hash, cpath, sizeof(cpath));
+            size = stat(cpath, &st) == 0 ? (uint64_t)st.st_size : 0;
+            gc.chunk_bytes += size;
+            *added += size;
+        } else if (delta < 0 && refs == 1) {
+            gc.chunk_bytes -= size;
+            if (gc.ndoomed == gc.doomed_cap) {
+                size_t cap = gc.doomed_cap ? 2 * gc.doomed_cap : 256;
+                void *d = realloc(gc.doomed, cap * SHA256_DIGEST_SIZE);
+                if (d) {
+                    gc.doomed = d;
+                    gc.doomed_cap = cap;
+                }
+            }
+            // Out of memory: the chunk just stays, unreferenced
+            if (gc.ndoomed < gc.doomed_cap) memcpy(gc.doomed[gc.ndoomed++], e.hash, SHA256_DIGEST_SIZE);
+        }
+        *val = (refs + delta) << 32 | size;
+    }
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+static void add_version(const index_record_t *r) {
+    if (gc.nversions == gc.versions_cap) {
+        size_t cap = gc.versions_cap ? 2 * gc.versions_cap : 1024;
+        gc_version_t *v = realloc(gc.versions, cap * sizeof(*v));
+        if (!v) return;
+        gc.versions = v;
+        gc.versions_cap = cap;
+    }
+    int64_t path = path_slot(index_record_path(r));
+    uint64_t *slot = map_get(&gc.version_map, r->version, 1);
+    gc_uid_t *uid = uid_usage(r->uid);
+    if (path < 0 || !slot || !uid) return;
+
+    gc_version_t *v = &gc.versions[gc.nversions];
+    *v = (gc_version_t){
+        .version = r->version, .time = r->time, .dev = r->dev, .ino = r->ino, .size = r->size,
+        .uid = r->uid, .mode = r->mode, .kind = r->kind, .live = 1, .path = path, .next = -1,
+        .name = strdup(index_record_name(r)),
+    };
+
+    char file[PATH_MAX];
+    struct stat st;
+    snprintf(file, sizeof(file), "%s/%s", gc.dir, v->name);
+    if (stat(file, &st) == 0) v->file_bytes = st.st_size;
+    gc.file_bytes += v->file_bytes;
+    v->charge = v->file_bytes;
+
+    if (v->kind == INDEX_MANIFEST) {
+        uint64_t added = 0;
+        v->holds_refs = count_chunks(v, 1, &added) == 0;
+        v->charge += added;
+    }
+    uid->bytes += v->charge;
+
+    // Append to the path's list, oldest first
+    gc_path_t *p = &gc.paths[path];
+    if (p->newest == -1) {
+        p->oldest = gc.nversions;
+    } else {
+        gc.versions[p->newest].next = gc.nversions;
+    }
+    p->newest = gc.nversions;
+    p->live++;
+    *slot = gc.nversions + 1;
+    gc.nversions++;
+}
+
+static void drop_version(gc_version_t *v) {
+    v->live = 0;
+    gc.file_bytes -= v->file_bytes;
+    gc_uid_t *u = uid_usage(v->uid);
+    if (u) u->bytes -= v->charge;
+    gc.paths[v->path].live--;
+    while (gc.oldest < gc.nversions && !gc.versions[gc.oldest].live) gc.oldest++;
+}
+
+// Tail the index: new versions, and versions deleted (by an earlier run)
+static void ingest(int paced) {
+    backup_index_map_t m;
+    if (backup_index_map(gc.dir, &m) != 0) return;
+    if (gc.index_off == 0) gc.index_off = 8;
+
+    const index_record_t *r;
+    while ((r = backup_index_at(&m, gc.index_off))) {
+        if (r->kind == INDEX_DELETED) {
+            uint64_t *slot = map_get(&gc.version_map, r->version, 0);
+            if (slot && gc.versions[*slot - 1].live) drop_version(&gc.versions[*slot - 1]);
+        } else {
+            add_version(r);
+            if (paced && r->kind == INDEX_MANIFEST) pace();
+        }
+        gc.index_off += r->len;
+    }
+    backup_index_unmap(&m);
+}
+
+// Journals keep growing while their window is open
+static void refresh_journals(void) {
+    for (size_t i = gc.oldest; i < gc.nversions; i++) {
+        gc_version_t *v = &gc.versions[i];
+        if (!v->live || v->kind != INDEX_JOURNAL) continue;
+
+        char file[PATH_MAX];
+        struct stat st;
+        snprintf(file, sizeof(file), "%s/%s", gc.dir, v->name);
+        if (stat(file, &st) != 0 || (uint64_t)st.st_size == v->file_bytes) continue;
+
+        uint64_t grown = st.st_size - v->file_bytes;
+        v->file_bytes += grown;
+        v->charge += grown;
+        gc.file_bytes += grown;
+        gc_uid_t *u = uid_usage(v->uid);
+        if (u) u->bytes += grown;
+    }
+}
+
+static void remove_version(gc_version_t *v, int reason) {
+    // Tombstone first: a crash after it leaves a stray file, never an
+    // index entry pointing at nothing
+    struct stat st = { 0 };
+    st.st_dev = v->dev;
+    st.st_ino = v->ino;
+    st.st_size = v->size;
+    st.st_uid = v->uid;
+    st.st_mode = v->mode;
+    if (backup_index_append(INDEX_DELETED, v->version, &st, v->time,
+                            gc.paths[v->path].path, v->name) != 0) {
+        return;
+    }
+
+    if (v->holds_refs) {
+        uint64_t unused;
+        count_chunks(v, -1, &unused);
+        pace();
+    }
+
+    char file[PATH_MAX];
+    snprintf(file, sizeof(file), "%s/%s", gc.dir, v->name);
+    unlink(file);
+    pace();
+
+    atomic_fetch_add_explicit(&gstats.bytes_freed, v->file_bytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&gstats.removed[reason], 1, memory_order_relaxed);
+    drop_version(v);
+}
+
+static uint64_t store_bytes(void) {
+    return gc.chunk_bytes + gc.file_bytes;
+}
+
+static void apply_policies(void) {
+    const backup_gc_policy_t *p = &gc.policy;
+    int64_t now = time(NULL);
+    int64_t newest_removable = now - p->min_age;
+
+    if (p->max_age) {
+        for (size_t i = gc.oldest; i < gc.nversions && !stopping(); i++) {
+            gc_version_t *v = &gc.versions[i];
+            if (v->live && v->time < now - (int64_t)p->max_age && v->time <= newest_removable) {
+                remove_version(v, GC_AGE);
+            }
+        }
+    }
+
+    if (p->max_versions) {
+        for (size_t i = 0; i < gc.npaths && !stopping(); i++) {
+            for (int32_t j = gc.paths[i].oldest; j != -1 && gc.paths[i].live > p->max_versions;
+                 j = gc.versions[j].next) {
+                gc_version_t *v = &gc.versions[j];
+                if (v->live && v->time <= newest_removable) remove_version(v, GC_VERSIONS);
+            }
+        }
+    }
+
+    if (p->uid_quota) {
+        for (size_t u = 0; u < gc.nuids && !stopping(); u++) {
+            for (size_t i = gc.oldest; i < gc.nversions && gc.uids[u].bytes > p->uid_quota; i++) {
+                gc_version_t *v = &gc.versions[i];
+                if (v->live && v->uid == gc.uids[u].uid && v->time <= newest_removable) {
+                    remove_version(v, GC_QUOTA);
+                }
+            }
+        }
+    }
+
+    if (p->max_bytes) {
+        for (size_t i = gc.oldest; i < gc.nversions && store_bytes() > p->max_bytes && !stopping(); i++) {
+            gc_version_t *v = &gc.versions[i];
+            if (v->live && v->time <= newest_removable) remove_version(v, GC_SIZE);
+        }
+    }
+}
+
+// Unlink chunks nothing references. Exclusive hold: no backup is between
+// storing chunks and indexing its manifest, and after catching up with
+// the index every reference to a doomed chunk has been counted.
+static void free_chunks(void) {
+    while (gc.ndoomed > 0 && !stopping()) {
+        size_t unlinked = 0;
+
+        pthread_rwlock_wrlock(&hold_lock);
+        ingest(0);
+        for (size_t n = 0; n < BACKUP_GC_BATCH && gc.ndoomed > 0; n++) {
+            const unsigned char *hash = gc.doomed[--gc.ndoomed];
+            uint64_t *val = map_get(&gc.chunk_map, chunk_key(hash), 0);
+            if (!val || *val >> 32 != 0 || (*val & 0xffffffff) == 0) continue;
+
+            char path[PATH_MAX];
+            chunk_path(hash, path, sizeof(path));
+            if (unlink(path) == 0) {
+                atomic_fetch_add_explicit(&gstats.chunks_freed, 1, memory_order_relaxed);
+                atomic_fetch_add_explicit(&gstats.bytes_freed, *val & 0xffffffff, memory_order_relaxed);
+            }
+            *val = 0;
+            unlinked++;
+        }
+        pthread_rwlock_unlock(&hold_lock);
+
+        while (unlinked--) pace();  // Outside the lock: backups never wait on pacing
+    }
+}
+
+static void map_reset(u64map_t *m) {
+    free(m->keys);
+    free(m->vals);
+    *m = (u64map_t){ 0 };
+}
+
+typedef struct {
+    size_t ingested;   // Old index bytes the GC has read
+    size_t new_off;    // Where they end in the rewritten index
+} compact_ctx_t;
+
+// Keep what the GC has not read yet, and every version it has not removed
+static int keep_record(const index_record_t *r, size_t off, void *arg) {
+    compact_ctx_t *ctx = arg;
+    if (off >= ctx->ingested) return 1;
+
+    // A version the GC never tracked keeps its record and its tombstone
+    uint64_t *slot = map_get(&gc.version_map, r->version, 0);
+    if (slot && !gc.versions[*slot - 1].live) return 0;
+    ctx->new_off += r->len;
+    return 1;
+}
+
+// Drop dead versions, paths nothing is kept for, idle uids and freed chunks
+static void compact_tables(void) {
+    gc_path_t *old_paths = gc.paths;
+    size_t old_npaths = gc.npaths;
+    gc.paths = NULL;
+    gc.npaths = gc.paths_cap = 0;
+    map_reset(&gc.path_map);
+    map_reset(&gc.version_map);
+
+    uint32_t *remap = calloc(old_npaths ? old_npaths : 1, sizeof(uint32_t));
+    size_t n = 0;
+    for (size_t i = 0; i < gc.nversions; i++) {
+        gc_version_t v = gc.versions[i];
+        if (!v.live) {
+            free(v.name);
+            continue;
+        }
+        // Paths come back in the order of their oldest live version
+        if (remap && !remap[v.path]) {
+            int64_t p = path_slot(old_paths[v.path].path);
+            remap[v.path] = p < 0 ? 0 : (uint32_t)p + 1;
+        }
+        uint64_t *slot = map_get(&gc.version_map, v.version, 1);
+        if (!remap || !remap[v.path] || !slot) {
+            free(v.name);  // Out of memory: forget it, as add_version would
+            continue;
+        }
+
+        v.path = remap[v.path] - 1;
+        v.next = -1;
+        gc_path_t *p = &gc.paths[v.path];
+        if (p->newest == -1) {
+            p->oldest = n;
+        } else {
+            gc.versions[p->newest].next = n;
+        }
+        p->newest = n;
+        p->live++;
+        *slot = n + 1;
+        gc.versions[n++] = v;
+    }
+    for (size_t i = 0; i < old_npaths; i++) free(old_paths[i].path);
+    free(old_paths);
+    free(remap);
+
+    gc.nversions = n;
+    gc.oldest = 0;
+    size_t cap = n > 1024 ? n : 1024;
+    gc_version_t *shrunk = realloc(gc.versions, cap * sizeof(*shrunk));
+    if (shrunk) {
+        gc.versions = shrunk;
+        gc.versions_cap = cap;
+    }
+
+    size_t u = 0;
+    for (size_t i = 0; i < gc.nuids; i++) {
+        if (gc.uids[i].bytes) gc.uids[u++] = gc.uids[i];
+    }
+    gc.nuids = u;
+
+    u64map_t chunks = gc.chunk_map;
+    gc.chunk_map = (u64map_t){ 0 };
+    for (size_t i = 0; chunks.mask && i <= chunks.mask; i++) {
+        if (!chunks.keys[i] || !chunks.vals[i]) continue;  // Unlinked
+        uint64_t *val = map_get(&gc.chunk_map, chunks.keys[i], 1);
+        if (val) *val = chunks.vals[i];
+    }
+    map_reset(&chunks);
+}
+
+// Once most tracked versions are dead, shed them from the index and from
+// memory. Never while chunks wait to be unlinked: their keys must stay.
+static void compact(void) {
+    if (gc.nversions < BACKUP_GC_COMPACT_MIN || gc.ndoomed || stopping()) return;
+
+    size_t live = 0;
+    for (size_t i = gc.oldest; i < gc.nversions; i++) live += gc.versions[i].live;
+    if (live * 100 >= gc.nversions * BACKUP_GC_COMPACT_LIVE) return;
+
+    // Read back our own tombstones first. The tables only forget what the
+    // index no longer lists.
+    ingest(0);
+    compact_ctx_t ctx = { gc.index_off, 8 };
+    size_t before = gc.nversions;
+    if (backup_index_compact(gc.dir, keep_record, &ctx) < 0) {
+        fprintf(stderr, "[SentinelFS] Backup index compaction failed: %s\n", strerror(errno));
+        return;
+    }
+    gc.index_off = ctx.new_off;
+    compact_tables();
+    fprintf(stderr, "[SentinelFS] Backup GC compacted: %zu of %zu versions live\n", gc.nversions, before);
+}
+
+static void *gc_thread(void *arg) {
+    (void) arg;
+    backup_io_thread();
+
+    pthread_mutex_lock(&gc.lock);
+    while (!stopping()) {
+        pthread_mutex_unlock(&gc.lock);
+
+        ingest(1);
+        refresh_journals();
+        apply_policies();
+        free_chunks();
+        compact();
+
+        size_t live = 0;
+        for (size_t i = gc.oldest; i < gc.nversions; i++) live += gc.versions[i].live;
+        atomic_store_explicit(&gstats.live, live, memory_order_relaxed);
+        atomic_store_explicit(&gstats.store_bytes, store_bytes(), memory_order_relaxed);
+
+        pthread_mutex_lock(&gc.lock);
+        if (stopping()) break;
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += BACKUP_GC_INTERVAL;
+        pthread_cond_timedwait(&gc.wake, &gc.lock, &ts);
+    }
+    pthread_mutex_unlock(&gc.lock);
+    return NULL;
+}
+
+int backup_gc_start(const char *backup_dir, const backup_gc_policy_t *policy) {
+    gc.policy = *policy;
+    if (gc.policy.rate == 0) gc.policy.rate = BACKUP_GC_RATE_DEFAULT;
+    snprintf(gc.dir, sizeof(gc.dir), "%s", backup_dir);
+
+    if (!policy->max_bytes && !policy->uid_quota && !policy->max_age && !policy->max_versions) {
+        return 0;  // Keep everything
+    }
+    if (pthread_create(&gc.thread, NULL, gc_thread, NULL) != 0) return -1;
+    gc.enabled = gc.running = 1;
+    return 0;
+}
+
+void backup_gc_stop(void) {
+    if (!gc.running) return;
+
+    pthread_mutex_lock(&gc.lock);
+    atomic_store(&gc.stop, 1);
+    pthread_cond_signal(&gc.wake);
+    pthread_mutex_unlock(&gc.lock);
+    pthread_join(gc.thread, NULL);
+    gc.running = 0;
+
+    for (size_t i = 0; i < gc.nversions; i++) free(gc.versions[i].name);
+    for (size_t i = 0; i < gc.npaths; i++) free(gc.paths[i].path);
+    free(gc.versions);
+    free(gc.paths);
+    free(gc.uids);
+    free(gc.doomed);
+    u64map_t *maps[] = { &gc.path_map, &gc.version_map, &gc.chunk_map };
+    for (int i = 0; i < 3; i++) {
+        free(maps[i]->keys);
+        free(maps[i]->vals);
+    }
+}
+
+void backup_gc_hold(void) {
+    pthread_rwlock_rdlock(&hold_lock);
+}
+
+void backup_gc_release(void) {
+    pthread_rwlock_unlock(&hold_lock);
+}
+
+void backup_gc_print_stats(FILE *out) {
+    if (!gc.enabled) return;
+    fprintf(out, "  Backup GC: %lu versions kept (%llu KB), removed by age %lu, versions %lu, "
+            "uid quota %lu, size %lu; %lu chunks freed, %llu KB freed\n",
+            atomic_load(&gstats.live), atomic_load(&gstats.store_bytes) / 1024,
+            atomic_load(&gstats.removed[GC_AGE]), atomic_load(&gstats.removed[GC_VERSIONS]),
+            atomic_load(&gstats.removed[GC_QUOTA]), atomic_load(&gstats.removed[GC_SIZE]),
+            atomic_load(&gstats.chunks_freed), atomic_load(&gstats.bytes_freed) / 1024);
+}
@@ -0,0 +1,58 @@
+/*
+ * SentinelFS - Backup retention and garbage collection
+ *
+ * A background thread tails the backup index, so it never scans the
+ * backup directory: every new version is read once (its manifest, to
+ * count references to its chunks) and every pass then applies the
+ * policies, oldest versions first. Removing a version appends an
+ * INDEX_DELETED record and drops its chunk references; a chunk is
+ * unlinked once nothing references it. All of this I/O is paced to a
+ * fixed number of operations per second.
+ *
+ * Versions younger than min_age (the backup window) are never removed:
+ * they protect the files being written right now, and filling a quota
+ * must not be a way to flush them out.
+ *
+ * Removed versions stay behind as dead entries in memory and as records
+ * plus tombstones in the index. Once fewer than BACKUP_GC_COMPACT_LIVE
+ * percent of the versions tracked are live, the GC rewrites the index
+ * without them and rebuilds its tables from the live versions, so a
+ * long-running mount (and the next restart) only pays for what is kept.
+ *
+ * Accounting: the store total is exact (live chunks, manifests,
+ * journals and pre-images on disk). A version is charged what it added to the store
+ * when it was indexed; per-uid quotas sum those charges.
+ */
+
+#ifndef SENTINELFS_BACKUP_GC_H
+#define SENTINELFS_BACKUP_GC_H
+
+#include <stdio.h>
+
+#define BACKUP_GC_INTERVAL 10                      // Seconds between passes
+#define BACKUP_GC_RATE_DEFAULT 200                 // Operations (unlinks, manifest reads) per second
+#define BACKUP_GC_MAX_AGE_DEFAULT (30 * 24 * 3600) // Seconds
+#define BACKUP_GC_BATCH 64                         // Chunk unlinks per exclusive hold
+#define BACKUP_GC_COMPACT_MIN 1024                 // Versions tracked before compaction is considered
+#define BACKUP_GC_COMPACT_LIVE 50                  // Compact once fewer than this % of them are live
+
+typedef struct {
+    unsigned long long max_bytes;  // Whole store, 0 = unlimited
+    unsigned long long uid_quota;  // Per owner uid, 0 = unlimited
+    unsigned max_age;              // Seconds, 0 = forever
+    unsigned max_versions;         // Per path, 0 = unlimited
+    unsigned min_age;              // Never remove versions younger than this
+    unsigned rate;                 // Operations per second
+} backup_gc_policy_t;
+
+int backup_gc_start(const char *backup_dir, const backup_gc_policy_t *policy);
+void backup_gc_stop(void);
+
+// Held (shared) by a backup from its first chunk until its manifest is in
+// the index, so the GC never unlinks a chunk it is about to reference
+void backup_gc_hold(void);
+void backup_gc_release(void);
+
+void backup_gc_print_stats(FILE *out);
+
+#endif /* SENTINELFS_BACKUP_GC_H */
@@ -0,0 +1,211 @@
+/*
+ * SentinelFS - Backup index
+ */
+
+#include "backup_index.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static int index_fd = -1;
+static _Atomic uint64_t next_version = 1;
+// Appends share it (O_APPEND keeps them whole), compaction excludes them
+static pthread_rwlock_t index_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+int backup_index_map(const char *backup_dir, backup_index_map_t *m) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", backup_dir, INDEX_FILE);
+    m->data = NULL;
+    m->size = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size < 8) {
+        close(fd);
+        return 0;  // Empty: nothing backed up yet
+    }
+
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+
+    if (memcmp(p, INDEX_MAGIC, 8) != 0) {
+        munmap(p, st.st_size);
+        errno = EINVAL;
+        return -1;
+    }
+    m->data = p;
+    m->size = st.st_size;
+    return 0;
+}
+
+void backup_index_unmap(backup_index_map_t *m) {
+    if (m->data) munmap((void *)m->data, m->size);
+    m->data = NULL;
+    m->size = 0;
+}
+
+const index_record_t *backup_index_at(const backup_index_map_t *m, size_t off) {
+    if (!m->data || off < 8 || off + sizeof(index_record_t) > m->size) return NULL;
+
+    const index_record_t *r = (const index_record_t *)(m->data + off);
+    if (r->len < sizeof(*r) + r->path_len + r->name_len + 2 || off + r->len > m->size) {
+        return NULL;  // Torn tail
+    }
+    return r;
+}
+
+const index_record_t *backup_index_next(const backup_index_map_t *m, const index_record_t *r) {
+    return backup_index_at(m, r ? (size_t)((const unsigned char *)r - m->data) + r->len : 8);
+}
+
+// Error path of backup_index_open: leave no half-open index behind
+static int open_failed(void) {
+    int saved = errno;
+    close(index_fd);
+    index_fd = -1;
+    errno = saved;
+    return -1;
+}
+
+int backup_index_open(const char *backup_dir) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", backup_dir, INDEX_FILE);
+
+    index_fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0600);
+    if (index_fd == -1) return -1;
+
+    struct stat st;
+    if (fstat(index_fd, &st) == -1) return open_failed();
+    if (st.st_size == 0 && write(index_fd, INDEX_MAGIC, 8) != 8) return open_failed();
+
+    // Continue numbering after the highest version on disk, and cut off a
+    // record torn by a crash so new appends stay readable
+    backup_index_map_t m;
+    if (backup_index_map(backup_dir, &m) != 0) {
+        fprintf(stderr, "[SentinelFS] Unreadable backup index: %s\n", path);
+        return open_failed();
+    }
+    uint64_t max = 0;
+    size_t end = 8;
+    for (const index_record_t *r = backup_index_next(&m, NULL); r; r = backup_index_next(&m, r)) {
+        if (r->version > max) max = r->version;
+        end = (size_t)((const unsigned char *)r - m.data) + r->len;
+    }
+    if (m.data && end < m.size && ftruncate(index_fd, end) == -1) {
+        backup_index_unmap(&m);
+        return open_failed();
+    }
+    backup_index_unmap(&m);
+    atomic_store(&next_version, max + 1);
+    return 0;
+}
+
+void backup_index_close(void) {
+    if (index_fd != -1) close(index_fd);
+    index_fd = -1;
+}
+
+uint64_t backup_index_next_version(void) {
+    return atomic_fetch_add_explicit(&next_version, 1, memory_order_relaxed);
+}
+
+int backup_index_append(uint32_t kind, uint64_t version, const struct stat *st, int64_t time,
+                        const char *path, const char *name) {
+    size_t path_len = strlen(path), name_len = strlen(name);
+    size_t len = (sizeof(index_record_t) + path_len + name_len + 2 + 7) & ~(size_t)7;
+
+    index_record_t *r = calloc(1, len);
+    if (!r) return -1;
+    r->len = len;
+    r->kind = kind;
+    r->version = version;
+    r->dev = st->st_dev;
+    r->ino = st->st_ino;
+    r->time = time;
+    r->size = st->st_size;
+    r->uid = st->st_uid;
+    r->mode = st->st_mode;
+    r->path_len = path_len;
+    r->name_len = name_len;
+    memcpy((char *)(r + 1), path, path_len);
+    memcpy((char *)(r + 1) + path_len + 1, name, name_len);
+
+    pthread_rwlock_rdlock(&index_lock);
+    ssize_t n = write(index_fd, r, len);
+    pthread_rwlock_unlock(&index_lock);
+    free(r);
+    if (n != (ssize_t)len) {
+        fprintf(stderr, "[SentinelFS] Backup index append failed: %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+long long backup_index_compact(const char *backup_dir,
+                               int (*keep)(const index_record_t *r, size_t off, void *arg), void *arg) {
+    char path[PATH_MAX], tmp[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", backup_dir, INDEX_FILE);
+    snprintf(tmp, sizeof(tmp), "%s/%s.compact", backup_dir, INDEX_FILE);
+
+    pthread_rwlock_wrlock(&index_lock);
+    backup_index_map_t m;
+    if (backup_index_map(backup_dir, &m) != 0 || !m.data) {
+        pthread_rwlock_unlock(&index_lock);
+        return -1;
+    }
+
+    FILE *out = fopen(tmp, "wb");
+    int ok = out && fwrite(INDEX_MAGIC, 8, 1, out) == 1;
+    long long size = 8;
+    uint64_t kept_max = 0;
+    const index_record_t *last = NULL;  // Highest version, its tombstone if deleted
+    for (const index_record_t *r = backup_index_next(&m, NULL); ok && r; r = backup_index_next(&m, r)) {
+        if (!last || r->version >= last->version) last = r;
+        if (!keep(r, (size_t)((const unsigned char *)r - m.data), arg)) continue;
+        ok = fwrite(r, r->len, 1, out) == 1;
+        size += r->len;
+        if (r->version > kept_max) kept_max = r->version;
+    }
+    // Version numbers must keep rising across a restart, which numbers on
+    // from the highest version in the index
+    if (ok && last && last->version > kept_max) {
+        ok = fwrite(last, last->len, 1, out) == 1;
+        size += last->len;
+    }
+    if (out) ok = fflush(out) == 0 && fsync(fileno(out)) == 0 && ok;
+    if (out && fclose(out) != 0) ok = 0;
+
+    // Opened before the rename, so appends can never go to the old file
+    int fd = ok ? open(tmp, O_WRONLY | O_APPEND) : -1;
+    if (fd != -1 && rename(tmp, path) == 0) {
+        close(index_fd);
+        index_fd = fd;
+        int dir = open(backup_dir, O_RDONLY | O_DIRECTORY);
+        if (dir != -1) {
+            fsync(dir);
+            close(dir);
+        }
+    } else {
+        if (fd != -1) close(fd);
+        unlink(tmp);
+        size = -1;
+    }
+    backup_index_unmap(&m);
+    pthread_rwlock_unlock(&index_lock);
+    return size;
+}
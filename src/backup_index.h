@@ -0,0 +1,81 @@
+/*
+ * SentinelFS - Backup index
+ *
+ * An append-only file in the backup directory with one record per backup
+ * version: the original path and inode, when the pre-image was taken, the
+ * original size, and the name of the manifest or journal holding it.
+ * Every backup gets a unique version number, which is also part of its
+ * file name, so two files with the same basename or two backups in the
+ * same second never collide.
+ *
+ * The daemon only appends (one write() per record on an O_APPEND fd, so
+ * concurrent appends never interleave). Readers mmap the file and walk
+ * the records; a record cut short by a crash ends the walk. When the GC
+ * removes a version it appends an INDEX_DELETED record carrying that
+ * version's number, so readers must skip versions deleted later on. Once
+ * most versions are dead, the GC rewrites the index without them and
+ * their tombstones (a tombstone may outlive its version record).
+ */
+
+#ifndef SENTINELFS_BACKUP_INDEX_H
+#define SENTINELFS_BACKUP_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define INDEX_FILE "index"
+#define INDEX_MAGIC "SFSIDX01"
+
+// INDEX_PREIMAGE: the removed file itself, hard-linked into the backup dir
+enum { INDEX_MANIFEST = 1, INDEX_JOURNAL = 2, INDEX_DELETED = 3, INDEX_PREIMAGE = 4 };
+
+typedef struct {
+    uint32_t len;        // Whole record including strings, multiple of 8
+    uint32_t kind;       // INDEX_MANIFEST, INDEX_JOURNAL, INDEX_DELETED or INDEX_PREIMAGE
+    uint64_t version;    // Unique, increasing
+    uint64_t dev;
+    uint64_t ino;
+    int64_t time;        // Wall clock seconds the pre-image was taken
+    uint64_t size;       // Original file size
+    uint32_t uid;
+    uint32_t mode;
+    uint32_t path_len;   // Original path, NUL-terminated, follows the record
+    uint32_t name_len;   // Backup file name in the backup dir, NUL-terminated, after the path
+} index_record_t;
+
+static inline const char *index_record_path(const index_record_t *r) {
+    return (const char *)(r + 1);
+}
+
+static inline const char *index_record_name(const index_record_t *r) {
+    return index_record_path(r) + r->path_len + 1;
+}
+
+// Daemon side: open (or create) backup_dir/index for appending
+int backup_index_open(const char *backup_dir);
+void backup_index_close(void);
+// Reserve a version number for a backup about to be written
+uint64_t backup_index_next_version(void);
+int backup_index_append(uint32_t kind, uint64_t version, const struct stat *st, int64_t time,
+                        const char *path, const char *name);
+// Rewrite the index with the records keep() accepts (off: the record's
+// offset in the old index), in order, and atomically replace it; appends
+// wait meanwhile. Returns the new index size, or -1 (index unchanged).
+long long backup_index_compact(const char *backup_dir,
+                               int (*keep)(const index_record_t *r, size_t off, void *arg), void *arg);
+
+// Reader side: a read-only mapping of the index as it is now
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+} backup_index_map_t;
+
+int backup_index_map(const char *backup_dir, backup_index_map_t *m);
+void backup_index_unmap(backup_index_map_t *m);
+// The record at byte offset off, or NULL at the end
+const index_record_t *backup_index_at(const backup_index_map_t *m, size_t off);
+// The record after r (the first if r is NULL), or NULL at the end
+const index_record_t *backup_index_next(const backup_index_map_t *m, const index_record_t *r);
+
+#endif /* SENTINELFS_BACKUP_INDEX_H */
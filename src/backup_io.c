@@ -0,0 +1,186 @@
+/*
+ * SentinelFS - Background backup I/O policy
+ */
+
+#define _GNU_SOURCE  // O_DIRECT, mkostemp(), sync_file_range()
+
+#include "backup_io.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// linux/ioprio.h is missing from older userspace headers
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_BE 2
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_BE_LOWEST 7
+
+const char *backup_ioprio_names[] = { "none", "be", "idle" };
+const char *backup_cache_names[] = { "keep", "drop", "direct" };
+
+static backup_ioprio_t io_prio;
+static backup_cache_t io_cache;
+
+// Debt-based token bucket: a worker takes its bytes and sleeps off any
+// deficit outside the lock, so concurrent workers share the rate
+static struct {
+    pthread_mutex_t lock;
+    double rate;     // Bytes per second, 0 = unlimited
+    double tokens;   // Negative: owed
+    double last;     // CLOCK_MONOTONIC seconds of the last refill
+} bucket = { PTHREAD_MUTEX_INITIALIZER, 0, 0, 0 };
+
+static _Atomic int unthrottled;
+
+static struct {
+    _Atomic unsigned long long throttled_us;  // Slept by workers over the rate
+    _Atomic unsigned long direct;             // Chunk files written with O_DIRECT
+    _Atomic unsigned long direct_refused;     // Filesystem refused O_DIRECT, wrote buffered
+    _Atomic unsigned long long dropped_bytes; // Written back and evicted from the page cache
+} iostats;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void backup_io_init(unsigned rate_mb, backup_ioprio_t ioprio, backup_cache_t cache) {
+    io_prio = ioprio;
+    io_cache = cache;
+    bucket.rate = (double)rate_mb * 1024 * 1024;
+    bucket.tokens = BACKUP_IO_BURST;
+    bucket.last = now_sec();
+}
+
+void backup_io_thread(void) {
+    int ioprio;
+    if (io_prio == BACKUP_IOPRIO_BE) {
+        ioprio = IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT | IOPRIO_BE_LOWEST;
+    } else if (io_prio == BACKUP_IOPRIO_IDLE) {
+        ioprio = IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT;
+    } else {
+        return;
+    }
+    // who = 0: the calling thread only, not the FUSE threads
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, ioprio) == -1) {
+        fprintf(stderr, "[SentinelFS] ioprio_set(%s) failed: %s\n", backup_ioprio_names[io_prio],
+                strerror(errno));
+    }
+}
+
+void backup_io_throttle(size_t bytes) {
+    if (bucket.rate == 0 || atomic_load_explicit(&unthrottled, memory_order_relaxed)) return;
+
+    pthread_mutex_lock(&bucket.lock);
+    double now = now_sec();
+    bucket.tokens += (now - bucket.last) * bucket.rate;
+    if (bucket.tokens > BACKUP_IO_BURST) bucket.tokens = BACKUP_IO_BURST;
+    bucket.last = now;
+    bucket.tokens -= bytes;
+    double wait = bucket.tokens < 0 ? -bucket.tokens / bucket.rate : 0;
+    pthread_mutex_unlock(&bucket.lock);
+
+    if (wait > 0) {
+        struct timespec ts = { (time_t)wait, (long)((wait - (time_t)wait) * 1e9) };
+        nanosleep(&ts, NULL);
+        atomic_fetch_add_explicit(&iostats.throttled_us, (unsigned long long)(wait * 1e6),
+                                  memory_order_relaxed);
+    }
+}
+
+void backup_io_unthrottle(void) {
+    atomic_store_explicit(&unthrottled, 1, memory_order_relaxed);
+}
+
+void backup_io_reading(int fd) {
+    // Don't let one pass over a big file push the applications' pages out
+    // (honored by the LRU since Linux 6.3, harmless before)
+    if (io_cache != BACKUP_CACHE_KEEP) posix_fadvise(fd, 0, 0, POSIX_FADV_NOREUSE);
+}
+
+int backup_io_mkstemp(char *tmpl, int *direct) {
+    *direct = 0;
+    if (io_cache == BACKUP_CACHE_DIRECT) {
+        size_t len = strlen(tmpl);
+        char *saved = strdup(tmpl);
+        int fd = saved ? mkostemp(tmpl, O_DIRECT) : -1;
+        if (fd != -1) *direct = 1;
+        if (fd == -1 && saved && errno == EINVAL) {
+            // tmpfs and friends refuse O_DIRECT at open: fresh template, buffered
+            memcpy(tmpl, saved, len);
+            atomic_fetch_add_explicit(&iostats.direct_refused, 1, memory_order_relaxed);
+        }
+        free(saved);
+        if (fd != -1 || errno != EINVAL) return fd;
+    }
+    return mkstemp(tmpl);
+}
+
+ssize_t backup_io_writev(int fd, int direct, const struct iovec *iov, int iovcnt) {
+    if (direct) {
+        size_t len = 0;
+        for (int i = 0; i < iovcnt; i++) len += iov[i].iov_len;
+        size_t padded = (len + BACKUP_IO_ALIGN - 1) & ~(size_t)(BACKUP_IO_ALIGN - 1);
+
+        unsigned char *buf;
+        if (posix_memalign((void **)&buf, BACKUP_IO_ALIGN, padded) != 0) return -1;
+        size_t pos = 0;
+        for (int i = 0; i < iovcnt; i++) {
+            memcpy(buf + pos, iov[i].iov_base, iov[i].iov_len);
+            pos += iov[i].iov_len;
+        }
+        memset(buf + len, 0, padded - len);
+
+        ssize_t n = pwrite(fd, buf, padded, 0);
+        int err = errno;
+        free(buf);
+        if (n == (ssize_t)padded) {
+            atomic_fetch_add_explicit(&iostats.direct, 1, memory_order_relaxed);
+            return ftruncate(fd, len) == 0 ? (ssize_t)len : -1;
+        }
+        if (n != -1 || err != EINVAL) return -1;
+
+        // Opened fine but the filesystem refuses the write: go buffered
+        atomic_fetch_add_explicit(&iostats.direct_refused, 1, memory_order_relaxed);
+        if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT) == -1) return -1;
+    }
+    return writev(fd, iov, iovcnt);
+}
+
+void backup_io_written(int fd) {
+    if (io_cache == BACKUP_CACHE_KEEP) return;
+
+    // DONTNEED only drops clean pages: write them back first
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) return;
+    sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                              SYNC_FILE_RANGE_WAIT_AFTER);
+    if (posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0) {
+        atomic_fetch_add_explicit(&iostats.dropped_bytes, st.st_size, memory_order_relaxed);
+    }
+}
+
+void backup_io_print_stats(FILE *out) {
+    fprintf(out, "  Backup I/O: ioprio %s, cache %s, rate ", backup_ioprio_names[io_prio],
+            backup_cache_names[io_cache]);
+    if (bucket.rate > 0) {
+        fprintf(out, "%.0f MB/s (throttled %llu ms)", bucket.rate / (1024 * 1024),
+                atomic_load(&iostats.throttled_us) / 1000);
+    } else {
+        fprintf(out, "unlimited");
+    }
+    fprintf(out, "; %llu KB dropped from cache, %lu O_DIRECT chunks (%lu refused)\n",
+            atomic_load(&iostats.dropped_bytes) / 1024, atomic_load(&iostats.direct),
+            atomic_load(&iostats.direct_refused));
+}
@@ -0,0 +1,63 @@
+/*
+ * SentinelFS - Background backup I/O policy
+ *
+ * Backup workers and the GC share the disk with the applications being
+ * protected. Three settings keep them out of the way:
+ *  - a token bucket caps the bytes workers stream into the chunk store per
+ *    second. The write path never waits on it: a writer only ever copies
+ *    the chunks it is about to overwrite.
+ *  - the background threads run in a lower I/O priority class.
+ *  - backup files are written back and dropped from the page cache, or
+ *    written with O_DIRECT, since nothing reads them until a restore.
+ */
+
+#ifndef SENTINELFS_BACKUP_IO_H
+#define SENTINELFS_BACKUP_IO_H
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define BACKUP_IO_BURST (1024 * 1024)  // Bytes a worker may move at once after idling
+#define BACKUP_IO_ALIGN 4096           // O_DIRECT buffer, offset and length alignment
+
+// I/O priority of the backup threads (-o backup_ioprio=)
+typedef enum {
+    BACKUP_IOPRIO_NONE = 0,  // Inherit the daemon's
+    BACKUP_IOPRIO_BE,        // Best-effort, lowest level
+    BACKUP_IOPRIO_IDLE       // Only when the disk is otherwise idle
+} backup_ioprio_t;
+
+// What backup files leave in the page cache (-o backup_cache=)
+typedef enum {
+    BACKUP_CACHE_KEEP = 0,   // Whatever the kernel decides
+    BACKUP_CACHE_DROP,       // Write back, then posix_fadvise(DONTNEED)
+    BACKUP_CACHE_DIRECT      // O_DIRECT chunk files, DROP for the rest
+} backup_cache_t;
+
+extern const char *backup_ioprio_names[];
+extern const char *backup_cache_names[];
+
+// rate_mb: MB per second streamed by the workers, 0 = unlimited
+void backup_io_init(unsigned rate_mb, backup_ioprio_t ioprio, backup_cache_t cache);
+// Put the calling thread in the configured I/O priority class
+void backup_io_thread(void);
+// A worker is about to move bytes: sleeps while over the rate
+void backup_io_throttle(size_t bytes);
+// Shutting down: remaining backups run at full speed
+void backup_io_unthrottle(void);
+
+// The backup reads fd sequentially, once (the source of a backup)
+void backup_io_reading(int fd);
+// mkstemp() for a backup file written in the background; *direct says
+// whether it was opened with O_DIRECT
+int backup_io_mkstemp(char *tmpl, int *direct);
+// writev() that pads O_DIRECT writes to the alignment and trims the file
+// back; falls back to buffered I/O where the filesystem refuses O_DIRECT
+ssize_t backup_io_writev(int fd, int direct, const struct iovec *iov, int iovcnt);
+// Done writing a background backup file: keep it out of the page cache
+void backup_io_written(int fd);
+
+void backup_io_print_stats(FILE *out);
+
+#endif /* SENTINELFS_BACKUP_IO_H */
@@ -0,0 +1,204 @@
+/*
+ * SentinelFS - Adaptive entropy baselines
+ *
+ * Each baseline is one 64-bit word, updated by compare-and-swap, so
+ * lookups and updates take no lock:
+ *
+ *   bits  0-15  tag (upper hash bits, never 0; 0 = free)
+ *   bits 16-31  writes learned, saturating
+ *   bits 32-47  mean entropy, in 1/4096 bits/byte
+ *   bits 48-63  variance, in 1/4096 (bits/byte)^2, saturating
+ *
+ * A key missing from its set takes the way with fewer writes learned.
+ */
+
+#include "baseline.h"
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#define WAYS 2
+#define SETS (BASELINE_SLOTS / WAYS)
+#define FIXED 4096.0
+#define TYPE_SALT 0x5bd1e9955bd1e995ull  // Keeps ".d" and a directory "d" apart
+
+typedef struct {
+    unsigned samples;
+    double mean;
+    double var;
+} baseline_t;
+
+static _Atomic uint64_t table[SETS][WAYS];
+static int enabled;
+
+static struct {
+    _Atomic unsigned long learned;   // Allowed writes folded into baselines
+    _Atomic unsigned long deviant;   // Writes flagged for deviating from their baselines
+    _Atomic unsigned long skipped;   // LibMagic calls saved by an expected high entropy
+} bstats;
+
+// FNV-1a, optionally ASCII case folded
+static uint64_t hash(const char *s, size_t len, int fold) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (fold && c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        h = (h ^ c) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+// Type and directory keys of a path; 0 if it has none
+static void keys(const char *path, uint64_t key[2]) {
+    const char *slash = strrchr(path, '/');
+    const char *base = slash ? slash + 1 : path;
+    const char *dot = strrchr(base, '.');
+    key[0] = dot && dot != base && dot[1] ? hash(dot + 1, strlen(dot + 1), 1) ^ TYPE_SALT : 0;
+    key[1] = hash(path, slash ? (size_t)(slash - path) : 0, 0);
+}
+
+static _Atomic uint64_t *set_of(uint64_t key) {
+    return table[(key * 0x9e3779b97f4a7c15ull >> 32) & (SETS - 1)];
+}
+
+static uint64_t tag_of(uint64_t key) {
+    uint64_t tag = key >> 48;
+    return tag ? tag : 1;
+}
+
+static void decode(uint64_t word, baseline_t *b) {
+    b->samples = (unsigned)(word >> 16 & 0xffff);
+    b->mean = (word >> 32 & 0xffff) / FIXED;
+    b->var = (word >> 48) / FIXED;
+}
+
+static uint64_t encode(uint64_t tag, const baseline_t *b) {
+    long mean = lrint(b->mean * FIXED);
+    long var = lrint(b->var * FIXED);
+    uint64_t m = mean < 0 ? 0 : mean > 0xffff ? 0xffff : (uint64_t)mean;
+    uint64_t v = var < 0 ? 0 : var > 0xffff ? 0xffff : (uint64_t)var;
+    uint64_t n = b->samples > 0xffff ? 0xffff : b->samples;
+    return tag | n << 16 | m << 32 | v << 48;
+}
+
+// Mature baseline of key, if there is one
+static int mature(uint64_t key, baseline_t *b) {
+    _Atomic uint64_t *set = set_of(key);
+    uint64_t tag = tag_of(key);
+    for (int w = 0; w < WAYS; w++) {
+        uint64_t word = atomic_load_explicit(&set[w], memory_order_relaxed);
+        if ((word & 0xffff) == tag) {
+            decode(word, b);
+            return b->samples >= BASELINE_MIN_SAMPLES;
+        }
+    }
+    return 0;
+}
+
+static void learn(uint64_t key, double entropy) {
+    _Atomic uint64_t *set = set_of(key);
+    uint64_t tag = tag_of(key);
+
+    for (;;) {
+        uint64_t old[WAYS];
+        int way = -1;
+        for (int w = 0; w < WAYS; w++) {
+            old[w] = atomic_load_explicit(&set[w], memory_order_relaxed);
+            if ((old[w] & 0xffff) == tag) way = w;
+        }
+
+        baseline_t b = { 0, 0.0, 0.0 };
+        if (way >= 0) {
+            decode(old[way], &b);
+        } else {
+            way = (old[0] >> 16 & 0xffff) <= (old[1] >> 16 & 0xffff) ? 0 : 1;
+        }
+
+        // Plain running mean while young, then EWMA; West's variance update
+        double a = b.samples < 1.0 / BASELINE_ALPHA ? 1.0 / (b.samples + 1) : BASELINE_ALPHA;
+        double diff = entropy - b.mean;
+        double incr = a * diff;
+        b.mean += incr;
+        b.var = (1.0 - a) * (b.var + diff * incr);
+        b.samples++;
+
+        if (atomic_compare_exchange_weak_explicit(&set[way], &old[way], encode(tag, &b),
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+void baseline_init(int on) {
+    enabled = on;
+}
+
+int baseline_enabled(void) {
+    return enabled;
+}
+
+baseline_verdict_t baseline_judge(const char *path, size_t len, double entropy, double *sigmas) {
+    *sigmas = 0.0;
+    if (!enabled || len < BASELINE_MIN_BYTES) return BASELINE_UNKNOWN;
+
+    uint64_t key[2];
+    keys(path, key);
+
+    int known = 0, above = 0, within = 0, type_known = 0;
+    for (int i = 0; i < 2; i++) {
+        baseline_t b;
+        if (!key[i] || !mature(key[i], &b)) continue;
+        if (i == 0) type_known = 1;
+
+        double sd = sqrt(b.var);
+        double z = (entropy - b.mean) / (sd > BASELINE_MIN_SD ? sd : BASELINE_MIN_SD);
+        if (!known++ || z < *sigmas) *sigmas = z;
+        if (z >= BASELINE_SIGMAS) above++;
+        else if (z > -BASELINE_SIGMAS) within++;
+    }
+
+    if (known && above == known) {
+        atomic_fetch_add_explicit(&bstats.deviant, 1, memory_order_relaxed);
+        return BASELINE_DEVIANT;
+    }
+    // Only a known type clears data: an archive directory would otherwise
+    // vouch for report.docx.locked
+    return type_known && within == known ? BASELINE_EXPECTED : BASELINE_UNKNOWN;
+}
+
+void baseline_learn(const char *path, size_t len, double entropy) {
+    if (!enabled || len < BASELINE_MIN_BYTES || entropy < 0) return;
+
+    uint64_t key[2];
+    keys(path, key);
+    for (int i = 0; i < 2; i++) {
+        if (key[i]) learn(key[i], entropy);
+    }
+    atomic_fetch_add_explicit(&bstats.learned, 1, memory_order_relaxed);
+}
+
+void baseline_count_skip(void) {
+    atomic_fetch_add_explicit(&bstats.skipped, 1, memory_order_relaxed);
+}
+
+void baseline_print_stats(FILE *out) {
+    if (!enabled) {
+        fprintf(out, "  Entropy baselines: off\n");
+        return;
+    }
+
+    unsigned used = 0, trusted = 0;
+    for (int s = 0; s < SETS; s++) {
+        for (int w = 0; w < WAYS; w++) {
+            uint64_t word = atomic_load_explicit(&table[s][w], memory_order_relaxed);
+            if (!word) continue;
+            used++;
+            if ((word >> 16 & 0xffff) >= BASELINE_MIN_SAMPLES) trusted++;
+        }
+    }
+    fprintf(out, "  Entropy baselines: %u of %d slots (%u mature), %lu writes learned, %lu deviant, %lu LibMagic calls skipped\n",
+            used, BASELINE_SLOTS, trusted, atomic_load(&bstats.learned),
+            atomic_load(&bstats.deviant), atomic_load(&bstats.skipped));
+}
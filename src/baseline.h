@@ -0,0 +1,55 @@
+/*
+ * SentinelFS - Adaptive entropy baselines
+ *
+ * One fixed threshold (7.5 bits/byte) fits no directory well: a folder of
+ * notes sits near 4.5, so partially encrypted text at 6.5 passes, while a
+ * folder of archives sits near 8.0 and every write to it needs LibMagic to
+ * be cleared. Each file type (keyed by extension, the cheap stand-in for
+ * its MIME type) and each directory therefore learns its own baseline: an
+ * exponentially weighted mean and variance of the entropy of the writes
+ * the pipeline allowed.
+ *
+ * A write is deviant when it lies BASELINE_SIGMAS standard deviations
+ * above every mature baseline it has; the entropy stage then flags it even
+ * below the fixed threshold. A high-entropy write that all its mature
+ * baselines expect lets the magic stage skip LibMagic, but only if its
+ * type's baseline is among them: a directory alone never clears new data.
+ *
+ * Baselines live in a static 2-way set-associative table of 8-byte words,
+ * so memory is fixed (32KB) and a lookup costs the same however many
+ * directories there are.
+ */
+
+#ifndef SENTINELFS_BASELINE_H
+#define SENTINELFS_BASELINE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define BASELINE_SLOTS 4096        // Types and directories together
+#define BASELINE_ALPHA (1.0 / 32)  // EWMA weight of a new write, once mature
+#define BASELINE_MIN_SAMPLES 32    // Writes learned before a baseline is trusted
+#define BASELINE_MIN_BYTES 1024    // Shorter buffers have too noisy an entropy
+#define BASELINE_MIN_SD 0.25       // Floor on the standard deviation, bits/byte
+#define BASELINE_SIGMAS 4.0        // Deviation from the mean that is flagged
+
+typedef enum {
+    BASELINE_UNKNOWN = 0,  // No mature baseline, or the buffer is too short
+    BASELINE_EXPECTED,     // Within every mature baseline, the type's among them
+    BASELINE_DEVIANT       // Above every mature baseline
+} baseline_verdict_t;
+
+void baseline_init(int enabled);
+int baseline_enabled(void);
+
+// Judge a write of len bytes to path (inside the mount) with this entropy.
+// *sigmas receives the smallest deviation from a mature baseline.
+baseline_verdict_t baseline_judge(const char *path, size_t len, double entropy, double *sigmas);
+// The pipeline allowed this write: fold it into its baselines
+void baseline_learn(const char *path, size_t len, double entropy);
+// The magic stage cleared a write on its baseline instead of calling LibMagic
+void baseline_count_skip(void);
+
+void baseline_print_stats(FILE *out);
+
+#endif /* SENTINELFS_BASELINE_H */
@@ -0,0 +1,167 @@
+/*
+ * SentinelFS - Canary files
+ *
+ * The set is sized at twice CANARY_MAX, so a probe chain stays short, and
+ * an inode number of 0 marks a free slot (no real file has one).
+ */
+
+#include "canary.h"
+#include "pid_score.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SLOTS (2 * CANARY_MAX)  // Power of two
+
+typedef struct {
+    dev_t dev;
+    ino_t ino;
+} canary_t;
+
+// Sort before and after ordinary names in either direction of a walk
+static const char *const seed_names[] = { "!Accounts.csv", "~Passwords.txt" };
+
+static canary_t set[SLOTS];
+static int armed;
+static int seeded;
+
+static struct {
+    _Atomic unsigned long tripped;  // Operations refused on a canary
+} cstats;
+
+static size_t slot(dev_t dev, ino_t ino) {
+    uint64_t h = ((uint64_t)ino ^ (uint64_t)dev << 32) * 0x9e3779b97f4a7c15ull;
+    return (h >> 32) & (SLOTS - 1);
+}
+
+static int add(const char *full_path) {
+    struct stat st;
+    if (stat(full_path, &st) == -1) {
+        fprintf(stderr, "[SentinelFS] Canary %s: %s\n", full_path, strerror(errno));
+        return -1;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        fprintf(stderr, "[SentinelFS] Canary %s: not a regular file\n", full_path);
+        return -1;
+    }
+    if (armed == CANARY_MAX) {
+        fprintf(stderr, "[SentinelFS] Canary %s: more than %d canaries\n", full_path, CANARY_MAX);
+        return -1;
+    }
+
+    size_t i = slot(st.st_dev, st.st_ino);
+    while (set[i].ino && !(set[i].dev == st.st_dev && set[i].ino == st.st_ino)) {
+        i = (i + 1) & (SLOTS - 1);
+    }
+    if (!set[i].ino) {
+        set[i].dev = st.st_dev;
+        set[i].ino = st.st_ino;
+        armed++;
+    }
+    return 0;
+}
+
+// A few KB of plausible content: some tools skip files that are too small
+static int write_decoy(const char *full_path, int csv) {
+    int fd = open(full_path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd == -1) return errno == EEXIST ? 0 : -1;
+
+    char text[8192];
+    size_t len = 0;
+    len += snprintf(text, sizeof(text), csv ? "date,account,description,amount\n"
+                                            : "Accounts and passwords - do not share\n\n");
+    for (unsigned row = 1; len < sizeof(text) - 128; row++) {
+        unsigned n = row * 2654435761u;
+        len += csv ? snprintf(text + len, sizeof(text) - len, "2024-%02u-%02u,%05u,Invoice %u,%u.%02u\n",
+                              n % 12 + 1, n / 12 % 28 + 1, n / 7 % 100000, n / 13 % 9000 + 1000,
+                              n / 17 % 5000, n / 19 % 100)
+                   : snprintf(text + len, sizeof(text) - len, "account%u: user%u / pw-%08x\n",
+                              row, n / 7 % 1000, n);
+    }
+
+    int res = write(fd, text, len) == (ssize_t)len ? 0 : -1;
+    close(fd);
+    if (res == 0) seeded++;
+    return res;
+}
+
+static void seed_dir(const char *dir) {
+    for (size_t i = 0; i < sizeof(seed_names) / sizeof(seed_names[0]); i++) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", dir, seed_names[i]);
+        if (write_decoy(path, i == 0) == 0) {
+            add(path);
+        } else {
+            fprintf(stderr, "[SentinelFS] Failed to seed canary %s: %s\n", path, strerror(errno));
+        }
+    }
+}
+
+static void seed(const char *storage) {
+    seed_dir(storage);
+
+    DIR *dp = opendir(storage);
+    if (!dp) return;
+    struct dirent *de;
+    while ((de = readdir(dp)) != NULL) {
+        if (de->d_name[0] == '.' || de->d_type != DT_DIR) continue;
+        char dir[PATH_MAX];
+        snprintf(dir, sizeof(dir), "%s/%s", storage, de->d_name);
+        seed_dir(dir);
+    }
+    closedir(dp);
+}
+
+int canary_init(const char *storage, const char *list, int seed_decoys) {
+    if (list) {
+        char *paths = strdup(list);
+        char *save = NULL;
+        for (char *p = paths ? strtok_r(paths, ":", &save) : NULL; p; p = strtok_r(NULL, ":", &save)) {
+            char full_path[PATH_MAX];
+            snprintf(full_path, sizeof(full_path), "%s%s%s", storage, p[0] == '/' ? "" : "/", p);
+            add(full_path);
+        }
+        free(paths);
+    }
+    if (seed_decoys) {
+        seed(storage);
+    }
+    return armed;
+}
+
+int canary_armed(void) {
+    return armed;
+}
+
+int canary_check(const struct stat *st, pid_t pid, const char *path, const char *op) {
+    if (!armed) return 0;
+
+    size_t i = slot(st->st_dev, st->st_ino);
+    while (set[i].ino) {
+        if (set[i].ino == st->st_ino && set[i].dev == st->st_dev) {
+            atomic_fetch_add_explicit(&cstats.tripped, 1, memory_order_relaxed);
+            fprintf(stderr, "[SentinelFS] ⚠️  Canary %s touched (%s) by process %d\n",
+                    path, op, (int)pid);
+            pid_score_flag(pid, "canary touched");
+            return 1;
+        }
+        i = (i + 1) & (SLOTS - 1);
+    }
+    return 0;
+}
+
+void canary_print_stats(FILE *out) {
+    if (!armed) {
+        fprintf(out, "  Canaries: none\n");
+        return;
+    }
+    fprintf(out, "  Canaries: %d armed (%d seeded this mount), %lu operations refused\n",
+            armed, seeded, atomic_load(&cstats.tripped));
+}
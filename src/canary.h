@@ -0,0 +1,38 @@
+/*
+ * SentinelFS - Canary files (-o canaries=..., -o canary_seed)
+ *
+ * A canary is a decoy file nobody has a reason to change. Operators name
+ * their own (paths inside the mount, ':'-separated), and canary_seed adds
+ * two to the storage root and to every top-level directory, named to sort
+ * before and after everything else so a walk in either order meets one
+ * early. Any write, truncate, rename or unlink of a canary is refused and
+ * flags the calling process at once (pid_score.h): no statistics have to
+ * build up first.
+ *
+ * Canaries are kept in an open-addressing set of (dev, ino), filled at
+ * mount and read-only afterwards, so the check on an ordinary file is one
+ * hash and one probe with no lock.
+ */
+
+#ifndef SENTINELFS_CANARY_H
+#define SENTINELFS_CANARY_H
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define CANARY_MAX 256  // Canaries armed at once
+
+// storage: backing directory; list: ':'-separated paths inside the mount
+// (NULL = none); seed: create the decoys where missing, except in hidden
+// directories (the backup directory). Returns the number armed.
+int canary_init(const char *storage, const char *list, int seed);
+int canary_armed(void);
+
+// Is st a canary? If so the trip is logged and pid flagged; returns 1.
+// op names the operation for the log.
+int canary_check(const struct stat *st, pid_t pid, const char *path, const char *op);
+
+void canary_print_stats(FILE *out);
+
+#endif /* SENTINELFS_CANARY_H */
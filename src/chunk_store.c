@@ -0,0 +1,270 @@
+/*
+ * SentinelFS - Content-addressed chunk store
+ *
+ * New chunks are written to a temporary file and renamed into place, so a
+ * chunk path either holds the complete chunk or does not exist, and two
+ * workers storing the same chunk at once cannot corrupt it. Compression
+ * happens only for new chunks, so deduplicated data costs a hash and a
+ * stat(), never a deflate.
+ */
+
+#include "chunk_store.h"
+#include "backup_io.h"
+#include "entropy.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <zlib.h>
+
+// Normalized chunking: harder to cut before CDC_AVG_SIZE, easier after.
+// The gear hash shifts left, so its high bits cover the most bytes.
+#define CDC_MASK_S (~0ULL << (64 - 15))
+#define CDC_MASK_L (~0ULL << (64 - 11))
+
+struct chunk_writer {
+    FILE *manifest;
+    char manifest_path[PATH_MAX];
+    unsigned char buf[2 * CDC_MAX_SIZE];
+    size_t fill;
+    int failed;
+    unsigned char *zbuf;    // Deflate output, NULL if not compressing
+    uLong zcap;
+    int background;         // On a worker: backup I/O policy applies
+};
+
+static uint64_t gear[256];
+static char chunk_dir[PATH_MAX - 128];  // Room for "/xx/<hash>" below it
+static int compress_chunks;
+
+static struct {
+    _Atomic unsigned long stored;         // New chunks written
+    _Atomic unsigned long deduplicated;   // Chunks already in the store
+    _Atomic unsigned long compressed;
+    _Atomic unsigned long high_entropy;   // Stored raw, not worth deflating
+    _Atomic unsigned long long logical_bytes;
+    _Atomic unsigned long long stored_bytes;  // On disk, after compression
+} cstats;
+
+int chunk_store_init(const char *backup_dir, int compress) {
+    compress_chunks = compress;
+
+    // Fixed seed: cut points must not change between runs, or nothing dedups
+    uint64_t x = 0x53656e74696e656cULL;
+    for (int i = 0; i < 256; i++) {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        gear[i] = z ^ (z >> 31);
+    }
+
+    snprintf(chunk_dir, sizeof(chunk_dir), "%s/%s", backup_dir, CHUNK_DIR);
+    if (mkdir(chunk_dir, 0700) == -1 && errno != EEXIST) return -1;
+
+    char path[PATH_MAX];
+    for (int i = 0; i < 256; i++) {
+        snprintf(path, sizeof(path), "%s/%02x", chunk_dir, i);
+        if (mkdir(path, 0700) == -1 && errno != EEXIST) return -1;
+    }
+    return 0;
+}
+
+size_t cdc_cut(const unsigned char *data, size_t len) {
+    if (len <= CDC_MIN_SIZE) return len;
+    if (len > CDC_MAX_SIZE) len = CDC_MAX_SIZE;
+    size_t normal = len < CDC_AVG_SIZE ? len : CDC_AVG_SIZE;
+
+    uint64_t fp = 0;
+    size_t i = CDC_MIN_SIZE;  // No cut point can fall before the minimum
+    for (; i < normal; i++) {
+        fp = (fp << 1) + gear[data[i]];
+        if (!(fp & CDC_MASK_S)) return i;
+    }
+    for (; i < len; i++) {
+        fp = (fp << 1) + gear[data[i]];
+        if (!(fp & CDC_MASK_L)) return i;
+    }
+    return len;
+}
+
+void chunk_path(const unsigned char hash[SHA256_DIGEST_SIZE], char *path, size_t size) {
+    char hex[2 * SHA256_DIGEST_SIZE + 1];
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
+        snprintf(hex + 2 * i, 3, "%02x", hash[i]);
+    }
+    snprintf(path, size, "%s/%.2s/%s", chunk_dir, hex, hex);
+}
+
+static int write_chunk(const char *path, unsigned char type, const unsigned char *data, size_t len,
+                       int background) {
+    char tmp[PATH_MAX];
+    snprintf(tmp, sizeof(tmp), "%s/.tmpXXXXXX", chunk_dir);
+    int direct = 0;
+    int fd = background ? backup_io_mkstemp(tmp, &direct) : mkstemp(tmp);
+    if (fd == -1) return -1;
+
+    struct iovec iov[2] = { { &type, 1 }, { (void *)data, len } };
+    ssize_t n = backup_io_writev(fd, direct, iov, 2);
+    if (background && !direct) backup_io_written(fd);
+    close(fd);
+
+    if (n != (ssize_t)(len + 1) || rename(tmp, path) == -1) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+static int store_chunk(chunk_writer_t *w, const unsigned char *data, size_t len) {
+    manifest_entry_t e;
+    sha256(data, len, e.hash);
+    e.len = len;
+
+    char path[PATH_MAX];
+    chunk_path(e.hash, path, sizeof(path));
+
+    if (access(path, F_OK) == 0) {
+        atomic_fetch_add_explicit(&cstats.deduplicated, 1, memory_order_relaxed);
+    } else {
+        unsigned char type = CHUNK_RAW;
+        const unsigned char *out = data;
+        size_t out_len = len;
+
+        if (w->zbuf && calculate_entropy(data, len) > CHUNK_RAW_ENTROPY) {
+            atomic_fetch_add_explicit(&cstats.high_entropy, 1, memory_order_relaxed);
+        } else if (w->zbuf) {
+            uLongf zlen = w->zcap;
+            if (compress2(w->zbuf, &zlen, data, len, CHUNK_COMPRESS_LEVEL) == Z_OK && zlen < len) {
+                type = CHUNK_ZLIB;
+                out = w->zbuf;
+                out_len = zlen;
+                atomic_fetch_add_explicit(&cstats.compressed, 1, memory_order_relaxed);
+            }
+        }
+
+        if (write_chunk(path, type, out, out_len, w->background) != 0) return -1;
+        atomic_fetch_add_explicit(&cstats.stored, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&cstats.stored_bytes, out_len + 1, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&cstats.logical_bytes, len, memory_order_relaxed);
+
+    return fwrite(&e, sizeof(e), 1, w->manifest) == 1 ? 0 : -1;
+}
+
+int chunk_read(const unsigned char hash[SHA256_DIGEST_SIZE], unsigned char *out, size_t len) {
+    char path[PATH_MAX];
+    chunk_path(hash, path, sizeof(path));
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return -1;
+
+    struct stat st;
+    unsigned char *data = NULL;
+    ssize_t n = -1;
+    if (fstat(fd, &st) == 0 && st.st_size > 0 && st.st_size <= (off_t)compressBound(CDC_MAX_SIZE) + 1 &&
+        (data = malloc(st.st_size))) {
+        n = read(fd, data, st.st_size);
+    }
+    close(fd);
+
+    int ok = 0;
+    if (n == st.st_size && data[0] == CHUNK_RAW) {
+        ok = (size_t)n - 1 == len;
+        if (ok) memcpy(out, data + 1, len);
+    } else if (n == st.st_size && data[0] == CHUNK_ZLIB) {
+        uLongf out_len = len;
+        ok = uncompress(out, &out_len, data + 1, n - 1) == Z_OK && out_len == len;
+    }
+    free(data);
+
+    unsigned char digest[SHA256_DIGEST_SIZE];
+    if (ok) sha256(out, len, digest);
+    return ok && memcmp(digest, hash, SHA256_DIGEST_SIZE) == 0 ? 0 : -1;
+}
+
+chunk_writer_t *chunk_writer_open(const char *manifest_path, const char *source_path, off_t size,
+                                  int background) {
+    chunk_writer_t *w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    snprintf(w->manifest_path, sizeof(w->manifest_path), "%s", manifest_path);
+    w->background = background;
+
+    if (compress_chunks && background) {
+        w->zcap = compressBound(CDC_MAX_SIZE);
+        w->zbuf = malloc(w->zcap);  // No buffer, no compression: still a valid backup
+    }
+
+    w->manifest = fopen(manifest_path, "wb");
+    if (!w->manifest) {
+        free(w->zbuf);
+        free(w);
+        return NULL;
+    }
+
+    manifest_header_t h = { .size = size, .avg_chunk = CDC_AVG_SIZE, .path_len = strlen(source_path) };
+    memcpy(h.magic, MANIFEST_MAGIC, sizeof(h.magic));
+    if (fwrite(&h, sizeof(h), 1, w->manifest) != 1 ||
+        fwrite(source_path, 1, h.path_len, w->manifest) != h.path_len) {
+        w->failed = 1;
+    }
+    return w;
+}
+
+// Cut and store every chunk whose end is certain: only the last
+// CDC_MAX_SIZE bytes may still grow
+static void drain(chunk_writer_t *w, int final) {
+    size_t pos = 0;
+    while (!w->failed && (w->fill - pos >= CDC_MAX_SIZE || (final && pos < w->fill))) {
+        size_t n = cdc_cut(w->buf + pos, w->fill - pos);
+        if (store_chunk(w, w->buf + pos, n) != 0) w->failed = 1;
+        pos += n;
+    }
+    memmove(w->buf, w->buf + pos, w->fill - pos);
+    w->fill -= pos;
+}
+
+int chunk_writer_add(chunk_writer_t *w, const void *data, size_t len) {
+    const unsigned char *p = data;
+    while (len > 0 && !w->failed) {
+        size_t n = sizeof(w->buf) - w->fill;
+        if (n > len) n = len;
+        memcpy(w->buf + w->fill, p, n);
+        w->fill += n;
+        p += n;
+        len -= n;
+        drain(w, 0);
+    }
+    return w->failed ? -1 : 0;
+}
+
+int chunk_writer_close(chunk_writer_t *w, int failed) {
+    if (!failed) drain(w, 1);
+    if (w->background && !failed && fflush(w->manifest) == 0) backup_io_written(fileno(w->manifest));
+    int error = fclose(w->manifest) != 0 || w->failed;
+
+    if (error) {
+        fprintf(stderr, "[SentinelFS] Chunk store write failed (%s): %s\n", strerror(errno),
+                w->manifest_path);
+    }
+    if (error || failed) unlink(w->manifest_path);
+    free(w->zbuf);
+    free(w);
+    return error || failed ? -1 : 0;
+}
+
+void chunk_store_print_stats(FILE *out) {
+    unsigned long long logical = atomic_load(&cstats.logical_bytes);
+    unsigned long long stored = atomic_load(&cstats.stored_bytes);
+    fprintf(out, "  Chunk store: %lu new chunks, %lu deduplicated (%llu KB backed up, %llu KB written",
+            atomic_load(&cstats.stored), atomic_load(&cstats.deduplicated), logical / 1024, stored / 1024);
+    if (logical > 0) fprintf(out, ", %.1f%%", 100.0 * stored / logical);
+    fprintf(out, ")\n");
+    fprintf(out, "  Chunks compressed: %lu, stored raw as high-entropy: %lu\n",
+            atomic_load(&cstats.compressed), atomic_load(&cstats.high_entropy));
+}
@@ -0,0 +1,76 @@
+/*
+ * SentinelFS - Content-addressed chunk store
+ *
+ * Backups are split into content-defined chunks (FastCDC: a gear rolling
+ * hash with normalized chunking), so an edit only changes the chunks
+ * around it and the cut points after it realign. Each chunk is stored once
+ * under <backup dir>/chunks/<xx>/<sha256>, and a backup is a manifest
+ * listing its chunks in order. Repeat backups of a file that changed a
+ * little write little more than the changed bytes.
+ *
+ * Manifest format: a manifest_header_t followed by the original path, then
+ * manifest_entry_t records. Restoring means concatenating the chunks.
+ * A chunk file is one CHUNK_RAW or CHUNK_ZLIB byte, then the data; the
+ * hash is always of the uncompressed data.
+ */
+
+#ifndef SENTINELFS_CHUNK_STORE_H
+#define SENTINELFS_CHUNK_STORE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "sha256.h"
+
+#define CDC_MIN_SIZE (2 * 1024)
+#define CDC_AVG_SIZE (8 * 1024)
+#define CDC_MAX_SIZE (64 * 1024)
+#define CHUNK_DIR "chunks"
+#define CHUNK_RAW_ENTROPY 7.5      // Chunks above this (bits/byte) are not worth compressing
+#define CHUNK_COMPRESS_LEVEL 1     // zlib level: fastest, backups are write-mostly
+#define MANIFEST_MAGIC "SFSMANI1"
+
+typedef struct {
+    char magic[8];      // MANIFEST_MAGIC
+    uint64_t size;      // Original file size
+    uint32_t avg_chunk; // CDC_AVG_SIZE at the time of writing
+    uint32_t path_len;  // Length of the original path that follows
+} manifest_header_t;
+
+typedef struct {
+    unsigned char hash[SHA256_DIGEST_SIZE];
+    uint32_t len;
+} manifest_entry_t;
+
+enum { CHUNK_RAW = 0, CHUNK_ZLIB = 1 };
+
+typedef struct chunk_writer chunk_writer_t;
+
+// Create the chunk directories under backup_dir. With compress, writers
+// opened as background store compressible chunks with zlib.
+int chunk_store_init(const char *backup_dir, int compress);
+
+// FastCDC cut point: length of the chunk starting at data (at most len)
+size_t cdc_cut(const unsigned char *data, size_t len);
+
+// Path of the chunk with this hash
+void chunk_path(const unsigned char hash[SHA256_DIGEST_SIZE], char *path, size_t size);
+
+// Read the chunk with this hash, len bytes uncompressed, into out and
+// check it against the hash. Returns 0 on success.
+int chunk_read(const unsigned char hash[SHA256_DIGEST_SIZE], unsigned char *out, size_t len);
+
+// Stream a file's contents into the store, writing its manifest to
+// manifest_path. Only a background writer compresses and follows the
+// backup I/O policy (backup_io.h). Returns NULL on error.
+chunk_writer_t *chunk_writer_open(const char *manifest_path, const char *source_path, off_t size,
+                                  int background);
+int chunk_writer_add(chunk_writer_t *w, const void *data, size_t len);
+// Flush the last chunk and close. On error, or if failed is set, the
+// manifest is removed. Returns 0 on success.
+int chunk_writer_close(chunk_writer_t *w, int failed);
+
+void chunk_store_print_stats(FILE *out);
+
+#endif /* SENTINELFS_CHUNK_STORE_H */
@@ -0,0 +1,29 @@
+/*
+ * SentinelFS - Shannon entropy
+ */
+
+#include "entropy.h"
+
+#include <math.h>
+
+double calculate_entropy(const unsigned char *buffer, size_t len) {
+    if (len == 0) return 0.0;
+
+    unsigned long counts[256] = {0};  // Stack allocated for speed
+
+    // Count byte frequencies
+    for (size_t i = 0; i < len; i++) {
+        counts[buffer[i]]++;
+    }
+
+    // Calculate entropy
+    double entropy = 0.0;
+    for (int i = 0; i < 256; i++) {
+        if (counts[i] > 0) {
+            double probability = (double)counts[i] / len;
+            entropy -= probability * log2(probability);
+        }
+    }
+
+    return entropy;
+}
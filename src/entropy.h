@@ -0,0 +1,17 @@
+/*
+ * SentinelFS - Shannon entropy
+ *
+ * Used by the detection pipeline and by the chunk store, which does not
+ * bother compressing data that is already close to random.
+ */
+
+#ifndef SENTINELFS_ENTROPY_H
+#define SENTINELFS_ENTROPY_H
+
+#include <stddef.h>
+
+// Shannon entropy: H(X) = -Σ P(x) * log₂(P(x))
+// Returns 0-8, encrypted data is usually ~7.9-8.0
+double calculate_entropy(const unsigned char *buffer, size_t len);
+
+#endif /* SENTINELFS_ENTROPY_H */
@@ -0,0 +1,138 @@
+/*
+ * SentinelFS - Fixed-size per-inode state table
+ */
+
+#include "inode_table.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INODE_TABLE_WAYS 8  // Entries per set, scanned linearly under the set lock
+
+typedef struct {
+    dev_t dev;
+    ino_t ino;
+    uint32_t stamp;  // Set-local LRU clock value of the last access
+    uint32_t used;
+} entry_header_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    uint32_t tick;
+} set_t;
+
+struct inode_table {
+    size_t sets;        // Power of two
+    size_t entry_size;  // Header + value, 16-byte aligned
+    set_t *set;
+    unsigned char *entries;
+    void (*evict)(void *value);
+};
+
+#define VALUE_OFFSET ((sizeof(entry_header_t) + 15) & ~(size_t)15)
+
+static uint64_t inode_hash(dev_t dev, ino_t ino) {
+    uint64_t h = (uint64_t)ino * 0x9e3779b97f4a7c15ull ^ (uint64_t)dev * 0xc2b2ae3d27d4eb4full;
+    return h ^ (h >> 29);
+}
+
+static entry_header_t *entry_at(inode_table_t *t, size_t index) {
+    return (entry_header_t *)(t->entries + index * t->entry_size);
+}
+
+static size_t set_of(inode_table_t *t, const void *value) {
+    size_t index = (size_t)((const unsigned char *)value - VALUE_OFFSET - t->entries) / t->entry_size;
+    return index / INODE_TABLE_WAYS;
+}
+
+inode_table_t *inode_table_create(size_t entries, size_t value_size,
+                                  void (*evict)(void *value)) {
+    inode_table_t *t = calloc(1, sizeof(*t));
+    if (!t) return NULL;
+
+    size_t sets = 1;
+    while (sets * INODE_TABLE_WAYS < entries) sets <<= 1;
+
+    t->sets = sets;
+    t->entry_size = (VALUE_OFFSET + value_size + 15) & ~(size_t)15;
+    t->evict = evict;
+    t->set = calloc(sets, sizeof(set_t));
+    t->entries = calloc(sets * INODE_TABLE_WAYS, t->entry_size);
+    if (!t->set || !t->entries) {
+        free(t->set);
+        free(t->entries);
+        free(t);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < sets; i++) {
+        pthread_mutex_init(&t->set[i].lock, NULL);
+    }
+    return t;
+}
+
+void inode_table_destroy(inode_table_t *t) {
+    if (!t) return;
+
+    for (size_t i = 0; i < t->sets * INODE_TABLE_WAYS; i++) {
+        entry_header_t *e = entry_at(t, i);
+        if (e->used && t->evict) t->evict((unsigned char *)e + VALUE_OFFSET);
+    }
+    for (size_t i = 0; i < t->sets; i++) {
+        pthread_mutex_destroy(&t->set[i].lock);
+    }
+    free(t->set);
+    free(t->entries);
+    free(t);
+}
+
+void *inode_table_get(inode_table_t *t, dev_t dev, ino_t ino, int create, int *created) {
+    size_t s = (size_t)inode_hash(dev, ino) & (t->sets - 1);
+    set_t *set = &t->set[s];
+    entry_header_t *victim = NULL;
+
+    if (created) *created = 0;
+    pthread_mutex_lock(&set->lock);
+
+    for (size_t w = 0; w < INODE_TABLE_WAYS; w++) {
+        entry_header_t *e = entry_at(t, s * INODE_TABLE_WAYS + w);
+        if (e->used && e->dev == dev && e->ino == ino) {
+            e->stamp = ++set->tick;
+            return (unsigned char *)e + VALUE_OFFSET;
+        }
+        if (!victim || (victim->used && (!e->used || (int32_t)(e->stamp - victim->stamp) < 0))) {
+            victim = e;
+        }
+    }
+
+    if (!create) {
+        pthread_mutex_unlock(&set->lock);
+        return NULL;
+    }
+
+    void *value = (unsigned char *)victim + VALUE_OFFSET;
+    if (victim->used && t->evict) t->evict(value);
+
+    memset(victim, 0, t->entry_size);
+    victim->dev = dev;
+    victim->ino = ino;
+    victim->used = 1;
+    victim->stamp = ++set->tick;
+    if (created) *created = 1;
+    return value;
+}
+
+void inode_table_put(inode_table_t *t, void *value) {
+    pthread_mutex_unlock(&t->set[set_of(t, value)].lock);
+}
+
+void inode_table_remove(inode_table_t *t, void *value) {
+    entry_header_t *e = (entry_header_t *)((unsigned char *)value - VALUE_OFFSET);
+    size_t s = set_of(t, value);
+
+    if (t->evict) t->evict(value);
+    e->used = 0;
+    pthread_mutex_unlock(&t->set[s].lock);
+}
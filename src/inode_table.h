@@ -0,0 +1,33 @@
+/*
+ * SentinelFS - Fixed-size per-inode state table
+ *
+ * Set-associative table keyed by (st_dev, st_ino). Memory is allocated once
+ * at mount time; when a set is full the least recently used entry in that
+ * set is evicted. Each set has its own lock, so lookups for different files
+ * rarely contend.
+ */
+
+#ifndef SENTINELFS_INODE_TABLE_H
+#define SENTINELFS_INODE_TABLE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef struct inode_table inode_table_t;
+
+// entries is rounded up to a power-of-two multiple of the set size. evict
+// (may be NULL) is called with the set locked before a value is recycled.
+inode_table_t *inode_table_create(size_t entries, size_t value_size,
+                                  void (*evict)(void *value));
+void inode_table_destroy(inode_table_t *table);
+
+// Find the value for (dev, ino), inserting a zeroed one if create is set.
+// On success the entry's set is locked until inode_table_put/remove; *created
+// (may be NULL) tells whether the value was just inserted. Returns NULL
+// (nothing locked) if the inode is absent and create is 0.
+void *inode_table_get(inode_table_t *table, dev_t dev, ino_t ino,
+                      int create, int *created);
+void inode_table_put(inode_table_t *table, void *value);
+void inode_table_remove(inode_table_t *table, void *value);
+
+#endif /* SENTINELFS_INODE_TABLE_H */
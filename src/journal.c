@@ -0,0 +1,110 @@
+/*
+ * SentinelFS - Block-level pre-image journal
+ *
+ * The journal is opened per append (O_APPEND, one writev per extent), so
+ * an idle journal holds no file descriptor. Only the journaled-block map
+ * stays in memory: one bit per JOURNAL_BLOCK of the original file.
+ */
+
+#include "journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+struct journal {
+    char path[PATH_MAX];
+    off_t size;             // Original size; blocks past it hold new data only
+    unsigned char *saved;   // Bitmap of journaled blocks
+};
+
+journal_t *journal_create(const char *journal_path, const char *source_path, off_t size) {
+    journal_t *j = calloc(1, sizeof(*j));
+    if (!j) return NULL;
+
+    size_t nblocks = (size + JOURNAL_BLOCK - 1) / JOURNAL_BLOCK;
+    j->saved = calloc((nblocks + 7) / 8, 1);
+    j->size = size;
+    snprintf(j->path, sizeof(j->path), "%s", journal_path);
+
+    int fd = open(journal_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (!j->saved || fd == -1) {
+        if (fd != -1) close(fd);
+        free(j->saved);
+        free(j);
+        return NULL;
+    }
+
+    journal_header_t h;
+    memcpy(h.magic, JOURNAL_MAGIC, sizeof(h.magic));
+    h.size = size;
+    h.block = JOURNAL_BLOCK;
+    h.path_len = strlen(source_path);
+
+    struct iovec iov[2] = {
+        { &h, sizeof(h) },
+        { (void *)source_path, h.path_len },
+    };
+    ssize_t n = writev(fd, iov, 2);
+    close(fd);
+
+    if (n != (ssize_t)(sizeof(h) + h.path_len)) {
+        unlink(journal_path);
+        free(j->saved);
+        free(j);
+        return NULL;
+    }
+    return j;
+}
+
+void journal_close(journal_t *j) {
+    if (!j) return;
+    free(j->saved);
+    free(j);
+}
+
+long long journal_save(journal_t *j, const char *source_path, off_t offset, off_t len) {
+    if (offset >= j->size || len <= 0) return 0;
+    off_t end = offset + len < j->size ? offset + len : j->size;
+
+    size_t first = offset / JOURNAL_BLOCK;
+    size_t last = (end - 1) / JOURNAL_BLOCK;
+
+    // Common case: everything already journaled, no I/O at all
+    size_t b = first;
+    while (b <= last && (j->saved[b / 8] & (1u << (b % 8)))) b++;
+    if (b > last) return 0;
+
+    int src = open(source_path, O_RDONLY);
+    int dst = open(j->path, O_WRONLY | O_APPEND);
+    unsigned char *buf = malloc(JOURNAL_BLOCK);
+    long long total = (src == -1 || dst == -1 || !buf) ? -1 : 0;
+
+    for (; total >= 0 && b <= last; b++) {
+        if (j->saved[b / 8] & (1u << (b % 8))) continue;
+
+        ssize_t n = pread(src, buf, JOURNAL_BLOCK, (off_t)b * JOURNAL_BLOCK);
+        journal_extent_t e = { (uint64_t)b * JOURNAL_BLOCK, (uint64_t)n };
+        struct iovec iov[2] = { { &e, sizeof(e) }, { buf, n } };
+        if (n < 0 || writev(dst, iov, 2) != (ssize_t)(sizeof(e) + n)) {
+            total = -1;
+            break;
+        }
+
+        j->saved[b / 8] |= 1u << (b % 8);
+        total += n;
+    }
+
+    if (total < 0) {
+        fprintf(stderr, "[SentinelFS] Journal append failed (%s): %s\n", strerror(errno), j->path);
+    }
+    free(buf);
+    if (src != -1) close(src);
+    if (dst != -1) close(dst);
+    return total;
+}
@@ -0,0 +1,47 @@
+/*
+ * SentinelFS - Block-level pre-image journal
+ *
+ * Files too large for a full JIT backup get a journal instead. Before the
+ * first overwrite of each JOURNAL_BLOCK-aligned block, the block's original
+ * bytes are appended to the file's journal, so the cost scales with the
+ * bytes modified rather than with the file size.
+ *
+ * On-disk format: a journal_header_t followed by the original path, then
+ * journal_extent_t records, each followed by its len bytes of pre-image.
+ * The records are the extent map: restoring means applying them, in
+ * order, to the current file and truncating it to header.size.
+ */
+
+#ifndef SENTINELFS_JOURNAL_H
+#define SENTINELFS_JOURNAL_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define JOURNAL_BLOCK (64 * 1024)
+#define JOURNAL_MAGIC "SFSJRNL1"
+
+typedef struct {
+    char magic[8];      // JOURNAL_MAGIC
+    uint64_t size;      // Original file size
+    uint32_t block;     // JOURNAL_BLOCK at the time of writing
+    uint32_t path_len;  // Length of the original path that follows
+} journal_header_t;
+
+typedef struct {
+    uint64_t offset;    // Where the pre-image belongs in the original
+    uint64_t len;
+} journal_extent_t;
+
+typedef struct journal journal_t;
+
+// Create journal_path for source_path, whose size is size. Returns NULL on error.
+journal_t *journal_create(const char *journal_path, const char *source_path, off_t size);
+void journal_close(journal_t *j);
+
+// Append the original bytes of every not yet journaled block overlapping
+// [offset, offset + len). Returns the number of bytes appended, -1 on error.
+// Not thread-safe: callers serialize access per journal.
+long long journal_save(journal_t *j, const char *source_path, off_t offset, off_t len);
+
+#endif /* SENTINELFS_JOURNAL_H */
@@ -0,0 +1,89 @@
+/*
+ * SentinelFS - Header-hash MIME verdict cache
+ *
+ * Each entry packs the 63-bit header hash and the verdict bit into one
+ * atomic word, so readers never see a torn entry and no lock is needed.
+ * LRU stamps are updated with relaxed atomics; replacement is therefore
+ * approximate under contention, which is fine for a cache.
+ */
+
+#include "mime_cache.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#define MIME_CACHE_SETS 256  // Power of two
+#define MIME_CACHE_WAYS 4
+
+typedef struct {
+    _Atomic uint64_t tag;    // (hash & ~1) | verdict, 0 = empty
+    _Atomic uint32_t stamp;  // Last use, from cache_clock
+} cache_entry_t;
+
+static cache_entry_t cache[MIME_CACHE_SETS][MIME_CACHE_WAYS];
+static _Atomic uint32_t cache_clock;
+
+// Word-at-a-time multiply/xor-shift hash over the leading bytes; the length
+// is mixed in so short buffers don't alias with longer ones
+static uint64_t header_hash(const unsigned char *buf, size_t len) {
+    size_t n = len < MIME_CACHE_KEY_BYTES ? len : MIME_CACHE_KEY_BYTES;
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ (uint64_t)n;
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        memcpy(&w, buf + i, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+    }
+    if (i < n) {
+        uint64_t w = 0;
+        memcpy(&w, buf + i, n - i);
+        h = (h ^ w) * 0xc4ceb9fe1a85ec53ull;
+    }
+
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 32;
+    return (h & ~1ull) ? h : 2;  // Keep tag 0 free for "empty"
+}
+
+int mime_cache_lookup(const unsigned char *buffer, size_t len, uint64_t *key) {
+    uint64_t h = header_hash(buffer, len);
+    cache_entry_t *set = cache[(h >> 1) & (MIME_CACHE_SETS - 1)];
+
+    *key = h;
+    for (int w = 0; w < MIME_CACHE_WAYS; w++) {
+        uint64_t tag = atomic_load_explicit(&set[w].tag, memory_order_acquire);
+        if ((tag & ~1ull) == (h & ~1ull)) {
+            uint32_t now = atomic_fetch_add_explicit(&cache_clock, 1, memory_order_relaxed);
+            atomic_store_explicit(&set[w].stamp, now, memory_order_relaxed);
+            return (int)(tag & 1);
+        }
+    }
+    return -1;
+}
+
+void mime_cache_insert(uint64_t key, int verdict) {
+    cache_entry_t *set = cache[(key >> 1) & (MIME_CACHE_SETS - 1)];
+    uint32_t now = atomic_fetch_add_explicit(&cache_clock, 1, memory_order_relaxed);
+
+    // Empty way first, otherwise the least recently used one
+    int victim = 0;
+    uint32_t max_age = 0;
+    for (int w = 0; w < MIME_CACHE_WAYS; w++) {
+        if (atomic_load_explicit(&set[w].tag, memory_order_relaxed) == 0) {
+            victim = w;
+            break;
+        }
+        uint32_t age = now - atomic_load_explicit(&set[w].stamp, memory_order_relaxed);
+        if (age >= max_age) {
+            max_age = age;
+            victim = w;
+        }
+    }
+
+    atomic_store_explicit(&set[victim].stamp, now, memory_order_relaxed);
+    atomic_store_explicit(&set[victim].tag, (key & ~1ull) | (verdict ? 1 : 0),
+                          memory_order_release);
+}
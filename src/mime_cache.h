@@ -0,0 +1,24 @@
+/*
+ * SentinelFS - Header-hash MIME verdict cache
+ *
+ * Writes from the same tool or file template share their leading bytes.
+ * This cache remembers the LibMagic whitelist verdict for a hash of the
+ * first MIME_CACHE_KEY_BYTES of the buffer so repeated header patterns
+ * skip magic_buffer() entirely. The table is a fixed-size static array
+ * (no allocation), 4-way set associative with approximate LRU replacement.
+ */
+
+#ifndef SENTINELFS_MIME_CACHE_H
+#define SENTINELFS_MIME_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MIME_CACHE_KEY_BYTES 128  // Leading bytes hashed into the key
+
+// Returns the cached verdict (0/1), or -1 on a miss. *key receives the
+// header hash for a following mime_cache_insert.
+int mime_cache_lookup(const unsigned char *buffer, size_t len, uint64_t *key);
+void mime_cache_insert(uint64_t key, int verdict);
+
+#endif /* SENTINELFS_MIME_CACHE_H */
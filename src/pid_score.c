@@ -0,0 +1,437 @@
+/*
+ * SentinelFS - Per-process behavioral scoring
+ *
+ * Slots are never emptied, only taken over once idle, so a key can never
+ * sit beyond an empty slot on its probe path: a lookup stops at the first
+ * empty slot, and an insert claims the first empty or idle one, after
+ * checking the whole path for the key. A takeover may race with a
+ * straggling event of the idle process; at worst the new one inherits a
+ * few counts.
+ */
+
+#define _GNU_SOURCE  // CLOCK_MONOTONIC_COARSE
+
+#include "pid_score.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define COUNTER_BITS 12
+#define COUNTER_MAX ((1u << COUNTER_BITS) - 1)
+#define COUNTER_UNIT 8       // Fixed point, 3 fractional bits: decay keeps fractions
+#define DECAY_TICKS 64       // 8 half-lives: everything has decayed to zero
+#define TICK_MASK 0xffff     // Tick stored in the top 16 bits of the counter word
+
+enum { C_WRITES, C_ENTROPIC, C_FILES, C_OVERWRITES, C_COUNT };
+
+typedef struct {
+    _Atomic pid_t pid;             // 0 = never used
+    _Atomic pid_t tgid;            // Process of this thread, 0 until resolved
+    _Atomic uint64_t counters;     // Process slots: tick << 48 | 4 x 12-bit counters
+    _Atomic uint64_t last_file;    // Last file written or touched
+    _Atomic uint64_t read_file;    // Last file read
+    _Atomic int64_t seen;          // Tick of the last event
+    _Atomic int64_t counted;       // Tick of the last counter update
+    _Atomic int64_t flagged_until; // Tick, 0 = never flagged
+    _Atomic unsigned score;        // Percent, as of the last event
+    _Atomic uint64_t bucket;       // Throttle: ns when the bucket is full again (GCRA)
+    _Atomic unsigned long delayed; // Throttled writes of this process
+    _Atomic uint64_t delay_us;     // Time they spent waiting
+    _Atomic unsigned sleeping;     // Its writes waiting right now
+    _Atomic uint64_t first_ns;     // First operation seen (CLOCK_MONOTONIC)
+    _Atomic uint64_t flagged_ns;   // First flagged, 0 = never
+    _Atomic unsigned long files;   // Switches to another file written or touched
+    _Atomic unsigned long flagged_files;  // ... when first flagged
+} pid_entry_t;
+
+static pid_entry_t *table;
+static unsigned threshold;
+static unsigned throttle_start;
+static unsigned decay[DECAY_TICKS];  // 2^(-t / half-life), Q16
+
+static struct {
+    _Atomic unsigned long flagged;    // Processes that crossed the threshold
+    _Atomic unsigned long refused;    // Operations failed because the process is flagged
+    _Atomic unsigned long untracked;  // No slot free on the probe path
+    _Atomic unsigned long delayed;    // Writes delayed by throttling
+    _Atomic uint64_t delay_us;
+    _Atomic unsigned long owed;       // Writes let through unslept, too many already waiting
+    _Atomic unsigned sleeping;        // Writes waiting right now, all processes
+} pstats;
+
+static int64_t now_ticks(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (int64_t)ts.tv_sec * PID_SCORE_TICK_HZ + ts.tv_nsec / (1000000000 / PID_SCORE_TICK_HZ);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint64_t file_key(const struct stat *st) {
+    uint64_t k = (uint64_t)st->st_dev * 0x9e3779b97f4a7c15ULL ^ (uint64_t)st->st_ino;
+    return k ? k : 1;  // 0 means "none"
+}
+
+int pid_score_init(unsigned threshold_percent, unsigned throttle_percent) {
+    threshold = threshold_percent;
+    throttle_start = throttle_percent < threshold ? throttle_percent : 0;
+    if (!threshold) return 0;
+
+    for (int t = 0; t < DECAY_TICKS; t++) {
+        decay[t] = (unsigned)(65536.0 * pow(2.0, -(double)t / PID_SCORE_HALFLIFE_TICKS));
+    }
+    table = calloc(PID_TABLE_SIZE, sizeof(pid_entry_t));
+    return table ? 0 : -1;
+}
+
+void pid_score_destroy(void) {
+    free(table);
+    table = NULL;
+}
+
+int pid_score_enabled(void) {
+    return table != NULL;
+}
+
+static int idle(pid_entry_t *e, int64_t now) {
+    return atomic_load_explicit(&e->seen, memory_order_relaxed) < now - PID_SCORE_IDLE * PID_SCORE_TICK_HZ &&
+           atomic_load_explicit(&e->flagged_until, memory_order_relaxed) < now;
+}
+
+static pid_entry_t *find(pid_t pid, int64_t now) {
+    size_t home = ((uint32_t)pid * 0x9e3779b1u) & (PID_TABLE_SIZE - 1);
+    pid_entry_t *claim = NULL;
+
+    for (size_t i = 0; i < PID_TABLE_PROBE; i++) {
+        pid_entry_t *e = &table[(home + i) & (PID_TABLE_SIZE - 1)];
+        pid_t k = atomic_load_explicit(&e->pid, memory_order_acquire);
+        if (k == pid) return e;
+        if (k == 0) {
+            if (!claim) claim = e;
+            break;
+        }
+        if (!claim && idle(e, now)) claim = e;
+    }
+
+    if (claim) {
+        pid_t old = atomic_load_explicit(&claim->pid, memory_order_acquire);
+        if (old == pid) return claim;  // Another thread of ours just claimed it
+        if ((old == 0 || idle(claim, now)) &&
+            atomic_compare_exchange_strong(&claim->pid, &old, pid)) {
+            atomic_store_explicit(&claim->tgid, 0, memory_order_relaxed);
+            atomic_store_explicit(&claim->counters, 0, memory_order_relaxed);
+            atomic_store_explicit(&claim->counted, 0, memory_order_relaxed);
+            atomic_store_explicit(&claim->last_file, 0, memory_order_relaxed);
+            atomic_store_explicit(&claim->read_file, 0, memory_order_relaxed);
+            atomic_store_explicit(&claim->flagged_until, 0, memory_order_relaxed);
+            atomic_store_explicit(&claim->score, 0, memory_order_relaxed);
+            atomic_store_explicit(&claim->bucket, 0, memory_order_relaxed);
+            atomic_store_explicit(&claim->delayed, 0, memory_order_relaxed);
+            atomic_store_explicit(&claim->delay_us, 0, memory_order_relaxed);
+            atomic_store_explicit(&claim->first_ns, now_ns(), memory_order_relaxed);
+            atomic_store_explicit(&claim->flagged_ns, 0, memory_order_relaxed);
+            atomic_store_explicit(&claim->files, 0, memory_order_relaxed);
+            atomic_store_explicit(&claim->flagged_files, 0, memory_order_relaxed);
+            atomic_store_explicit(&claim->seen, now, memory_order_release);
+            return claim;
+        }
+        if (old == pid) return claim;
+    }
+    atomic_fetch_add_explicit(&pstats.untracked, 1, memory_order_relaxed);
+    return NULL;
+}
+
+// Once per thread: which process it belongs to
+static pid_t read_tgid(pid_t tid) {
+    char path[64], line[128];
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)tid);
+    FILE *f = fopen(path, "r");
+    if (!f) return tid;
+
+    pid_t tgid = tid;
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "Tgid:", 5) == 0) {
+            tgid = (pid_t)atoi(line + 5);
+            break;
+        }
+    }
+    fclose(f);
+    return tgid > 0 ? tgid : tid;
+}
+
+// The slot holding the scores of pid's process
+static pid_entry_t *process(pid_t pid, int64_t now) {
+    if (pid <= 0) return NULL;
+    pid_entry_t *e = find(pid, now);
+    if (!e) return NULL;
+
+    pid_t tgid = atomic_load_explicit(&e->tgid, memory_order_relaxed);
+    if (tgid == 0) {
+        tgid = read_tgid(pid);
+        atomic_store_explicit(&e->tgid, tgid, memory_order_relaxed);
+    }
+    atomic_store_explicit(&e->seen, now, memory_order_relaxed);
+    if (tgid == pid) return e;
+
+    pid_entry_t *p = find(tgid, now);
+    if (p) {
+        atomic_store_explicit(&p->tgid, tgid, memory_order_relaxed);
+        atomic_store_explicit(&p->seen, now, memory_order_relaxed);
+    }
+    return p;
+}
+
+pid_t pid_score_process(pid_t pid) {
+    if (!table || pid <= 0) return pid > 0 ? read_tgid(pid) : pid;
+    pid_entry_t *p = process(pid, now_ticks());
+    return p ? atomic_load_explicit(&p->pid, memory_order_relaxed) : read_tgid(pid);
+}
+
+int pid_score_blocked(pid_t pid) {
+    if (!table) return 0;
+    int64_t now = now_ticks();
+    pid_entry_t *p = process(pid, now);
+    if (!p || atomic_load_explicit(&p->flagged_until, memory_order_relaxed) <= now) return 0;
+
+    atomic_store_explicit(&p->flagged_until, now + PID_SCORE_FLAG_TTL * PID_SCORE_TICK_HZ,
+                          memory_order_relaxed);
+    atomic_fetch_add_explicit(&pstats.refused, 1, memory_order_relaxed);
+    return 1;
+}
+
+int pid_score_flagged(pid_t pid) {
+    if (!table) return 0;
+    int64_t now = now_ticks();
+    pid_entry_t *p = process(pid, now);
+    return p && atomic_load_explicit(&p->flagged_until, memory_order_relaxed) > now;
+}
+
+// Decay the counters to now and add the event, in one CAS loop
+static void add_counts(pid_entry_t *p, int64_t now, const unsigned inc[C_COUNT],
+                       unsigned out[C_COUNT]) {
+    // The word's 16-bit tick wraps; a slot idle that long has decayed anyway
+    int stale = now - atomic_load_explicit(&p->counted, memory_order_relaxed) >= DECAY_TICKS;
+    uint64_t old = atomic_load_explicit(&p->counters, memory_order_relaxed);
+    uint64_t next;
+    do {
+        unsigned dt = stale ? DECAY_TICKS : (unsigned)((now - (int64_t)(old >> 48)) & TICK_MASK);
+        if (dt > TICK_MASK / 2) dt = 0;  // A racing thread already moved it past our now
+        next = (uint64_t)(now & TICK_MASK) << 48;
+        for (int c = 0; c < C_COUNT; c++) {
+            unsigned v = (old >> (c * COUNTER_BITS)) & COUNTER_MAX;
+            v = dt < DECAY_TICKS ? (unsigned)(((uint64_t)v * decay[dt]) >> 16) : 0;
+            v += inc[c];
+            if (v > COUNTER_MAX) v = COUNTER_MAX;
+            out[c] = v;
+            next |= (uint64_t)v << (c * COUNTER_BITS);
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&p->counters, &old, next, memory_order_relaxed,
+                                                    memory_order_relaxed));
+    atomic_store_explicit(&p->counted, now, memory_order_relaxed);
+}
+
+// Entropy share, scaled up by mass file activity and by destroying what
+// was read: a single-file compressor stays at half the entropy share
+static unsigned score_of(const unsigned c[C_COUNT]) {
+    if (c[C_WRITES] < PID_SCORE_MIN_WRITES * COUNTER_UNIT) return 0;
+    double entropic = (double)c[C_ENTROPIC] / c[C_WRITES];
+
+    // Decayed event count ~ rate * half-life / ln 2
+    double files = (double)c[C_FILES] / COUNTER_UNIT;
+    double rate = files * M_LN2 * PID_SCORE_TICK_HZ / PID_SCORE_HALFLIFE_TICKS;
+    double activity = rate < PID_SCORE_FILE_RATE ? rate / PID_SCORE_FILE_RATE : 1.0;
+    double destroyed = c[C_FILES] ? 2.0 * c[C_OVERWRITES] / c[C_FILES] : 0.0;
+    if (destroyed > 1.0) destroyed = 1.0;
+
+    return (unsigned)(100.0 * entropic * (0.5 + 0.25 * activity + 0.25 * destroyed));
+}
+
+static void flag(pid_entry_t *p, int64_t now, const char *why) {
+    int64_t until = atomic_load_explicit(&p->flagged_until, memory_order_relaxed);
+    if (until <= now && atomic_compare_exchange_strong(&p->flagged_until, &until,
+                                                       now + PID_SCORE_FLAG_TTL * PID_SCORE_TICK_HZ)) {
+        atomic_fetch_add_explicit(&pstats.flagged, 1, memory_order_relaxed);
+
+        // Time to detect, kept from the first flag for the stats file
+        uint64_t first = atomic_load_explicit(&p->first_ns, memory_order_relaxed);
+        uint64_t at = now_ns(), never = 0;
+        unsigned long files = atomic_load_explicit(&p->files, memory_order_relaxed);
+        if (atomic_compare_exchange_strong(&p->flagged_ns, &never, at)) {
+            atomic_store_explicit(&p->flagged_files, files, memory_order_relaxed);
+        }
+        fprintf(stderr, "[SentinelFS] ⚠️  Process %d flagged (%s) %.3fs after its first operation, %lu files touched: blocking its writes\n",
+                (int)atomic_load(&p->pid), why, (at - first) / 1e9, files);
+    }
+}
+
+static void record(pid_t pid, const struct stat *st, int written, int entropic, int overwrites) {
+    int64_t now = now_ticks();
+    pid_entry_t *p = process(pid, now);
+    if (!p) return;
+
+    uint64_t key = file_key(st);
+    int new_file = atomic_exchange_explicit(&p->last_file, key, memory_order_relaxed) != key;
+    int after_read = overwrites && new_file &&
+                     atomic_load_explicit(&p->read_file, memory_order_relaxed) == key;
+
+    if (new_file) atomic_fetch_add_explicit(&p->files, 1, memory_order_relaxed);
+
+    unsigned inc[C_COUNT] = {
+        written ? COUNTER_UNIT : 0,
+        entropic ? COUNTER_UNIT : 0,
+        new_file ? COUNTER_UNIT : 0,
+        after_read ? COUNTER_UNIT : 0,
+    };
+    unsigned c[C_COUNT];
+    add_counts(p, now, inc, c);
+
+    unsigned score = score_of(c);
+    atomic_store_explicit(&p->score, score, memory_order_relaxed);
+    if (score < threshold) return;
+
+    char why[32];
+    snprintf(why, sizeof(why), "score %u%%", score);
+    flag(p, now, why);
+}
+
+void pid_score_read(pid_t pid, const struct stat *st) {
+    if (!table) return;
+    pid_entry_t *p = process(pid, now_ticks());
+    if (p) atomic_store_explicit(&p->read_file, file_key(st), memory_order_relaxed);
+}
+
+void pid_score_write(pid_t pid, const struct stat *st, off_t offset, int entropic) {
+    if (!table) return;
+    record(pid, st, 1, entropic, offset < st->st_size);
+}
+
+void pid_score_touch(pid_t pid, const struct stat *st, int destroys) {
+    if (!table) return;
+    record(pid, st, 0, 0, destroys);
+}
+
+void pid_score_flag(pid_t pid, const char *why) {
+    if (!table) return;
+    int64_t now = now_ticks();
+    pid_entry_t *p = process(pid, now);
+    if (p) flag(p, now, why);
+}
+
+// Bytes per second a process with this score may write, 0 = unlimited
+static double throttle_rate(unsigned score) {
+    if (!throttle_start || score < throttle_start) return 0.0;
+    double x = (double)(score - throttle_start) / (threshold - throttle_start);
+    if (x > 1.0) x = 1.0;
+    return PID_THROTTLE_FAST_MB * pow(PID_THROTTLE_SLOW_MB / PID_THROTTLE_FAST_MB, x) * 1048576.0;
+}
+
+// Take a place among the writes sleeping in FUSE workers, of this
+// process and of all; 0 if either is full
+static int sleeper_enter(pid_entry_t *p) {
+    if (atomic_fetch_add_explicit(&p->sleeping, 1, memory_order_relaxed) >= PID_THROTTLE_MAX_SLEEPING) {
+        atomic_fetch_sub_explicit(&p->sleeping, 1, memory_order_relaxed);
+        return 0;
+    }
+    if (atomic_fetch_add_explicit(&pstats.sleeping, 1, memory_order_relaxed) >= PID_THROTTLE_MAX_SLEEPING_ALL) {
+        atomic_fetch_sub_explicit(&pstats.sleeping, 1, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&p->sleeping, 1, memory_order_relaxed);
+        return 0;
+    }
+    return 1;
+}
+
+static void sleeper_leave(pid_entry_t *p) {
+    atomic_fetch_sub_explicit(&pstats.sleeping, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&p->sleeping, 1, memory_order_relaxed);
+}
+
+// The bucket is one timestamp: when it will be full again. Each write
+// pushes it back by bytes / rate; a write that would push it more than
+// a burst past now waits for the difference, unless too many writes are
+// waiting already: then it goes through at once and its charge stays in
+// the bucket, for the process's next writes to wait off.
+void pid_score_throttle(pid_t pid, size_t bytes) {
+    if (!table || !throttle_start) return;
+    pid_entry_t *p = process(pid, now_ticks());
+    if (!p) return;
+    double rate = throttle_rate(atomic_load_explicit(&p->score, memory_order_relaxed));
+    if (rate == 0.0) return;
+
+    uint64_t now = now_ns();
+    uint64_t cost = (uint64_t)(bytes / rate * 1e9);
+    uint64_t burst = (uint64_t)(PID_THROTTLE_BURST / rate * 1e9);
+    uint64_t old = atomic_load_explicit(&p->bucket, memory_order_relaxed);
+    uint64_t next;
+    do {
+        next = (old > now ? old : now) + cost;
+    } while (!atomic_compare_exchange_weak_explicit(&p->bucket, &old, next, memory_order_relaxed,
+                                                    memory_order_relaxed));
+
+    if (next <= now + burst) return;
+    if (!sleeper_enter(p)) {
+        atomic_fetch_add_explicit(&pstats.owed, 1, memory_order_relaxed);
+        return;
+    }
+    uint64_t wait = next - now - burst;
+    if (wait > PID_THROTTLE_MAX_DELAY_MS * 1000000ull) wait = PID_THROTTLE_MAX_DELAY_MS * 1000000ull;
+
+    atomic_fetch_add_explicit(&p->delayed, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&p->delay_us, wait / 1000, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pstats.delayed, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pstats.delay_us, wait / 1000, memory_order_relaxed);
+
+    struct timespec ts = { (time_t)(wait / 1000000000ull), (long)(wait % 1000000000ull) };
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+    }
+    sleeper_leave(p);
+}
+
+void pid_score_print_stats(FILE *out) {
+    if (!table) return;
+    int64_t now = now_ticks();
+    unsigned long tracked = 0, flagged = 0;
+    for (size_t i = 0; i < PID_TABLE_SIZE; i++) {
+        pid_entry_t *e = &table[i];
+        pid_t pid = atomic_load(&e->pid);
+        if (!pid || atomic_load(&e->tgid) != pid || idle(e, now)) continue;
+        tracked++;
+        if (atomic_load(&e->flagged_until) > now) flagged++;
+    }
+    fprintf(out, "  Process scoring: %lu tracked, %lu flagged now (%lu ever), %lu operations refused, %lu untracked\n",
+            tracked, flagged, atomic_load(&pstats.flagged), atomic_load(&pstats.refused),
+            atomic_load(&pstats.untracked));
+    if (throttle_start) {
+        fprintf(out, "  Write throttling: from %u%% (%.0f MB/s) to %u%% (%.0f MB/s), %lu writes delayed for %.2fs, %lu let through owing with %u waiting\n",
+                throttle_start, PID_THROTTLE_FAST_MB, threshold, PID_THROTTLE_SLOW_MB,
+                atomic_load(&pstats.delayed), atomic_load(&pstats.delay_us) / 1e6,
+                atomic_load(&pstats.owed), atomic_load(&pstats.sleeping));
+    }
+    for (size_t i = 0; i < PID_TABLE_SIZE; i++) {
+        pid_entry_t *e = &table[i];
+        pid_t pid = atomic_load(&e->pid);
+        if (!pid || atomic_load(&e->tgid) != pid || idle(e, now)) continue;
+
+        unsigned score = atomic_load(&e->score);
+        unsigned long delayed = atomic_load(&e->delayed);
+        if (atomic_load(&e->flagged_until) > now) {
+            fprintf(out, "    pid %d: score %u%%, flagged %.3fs after its first operation, %lu files touched by then\n",
+                    (int)pid, score, (atomic_load(&e->flagged_ns) - atomic_load(&e->first_ns)) / 1e9,
+                    atomic_load(&e->flagged_files));
+        } else if (throttle_rate(score) > 0.0 || delayed) {
+            double rate = throttle_rate(score);
+            char limit[32] = "not throttled now";
+            if (rate > 0.0) snprintf(limit, sizeof(limit), "throttled to %.1f MB/s", rate / 1048576.0);
+            fprintf(out, "    pid %d: score %u%%, %s, %lu writes delayed for %.2fs\n", (int)pid,
+                    score, limit, delayed, atomic_load(&e->delay_us) / 1e6);
+        }
+    }
+}
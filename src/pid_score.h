@@ -0,0 +1,92 @@
+/*
+ * SentinelFS - Per-process behavioral scoring
+ *
+ * Every write, read, unlink, rename and truncate updates a decaying score
+ * for the process behind it (fuse_get_context()->pid, folded into its
+ * thread group so all of a process's threads share one score):
+ *
+ *  - high-entropy writes nothing vouched for, as a share of its writes;
+ *  - files touched per second;
+ *  - files it read and then overwrote, truncated, unlinked or renamed over.
+ *
+ * Counters halve every PID_SCORE_HALFLIFE_TICKS, so a score reflects the
+ * last few seconds. Once the score crosses the threshold the process is
+ * flagged, and every write or destructive operation it attempts fails
+ * until it has been quiet for PID_SCORE_FLAG_TTL seconds. The stats file
+ * shows how long after its first operation, and after how many files, each
+ * flagged process was caught.
+ *
+ * Below the threshold the response is graduated: once a process scores
+ * the throttle start, its writes pass a token bucket whose rate falls
+ * geometrically from PID_THROTTLE_FAST_MB to PID_THROTTLE_SLOW_MB per
+ * second as the score climbs to the threshold. A write over budget is
+ * delayed, not failed, so a false positive only runs slower while damage
+ * spreads slower.
+ *
+ * The delay is a sleep in the FUSE worker serving the write, and libfuse
+ * runs at most max_threads of them (10 by default). So that throttled
+ * processes cannot hold every worker and stall everyone else, at most
+ * PID_THROTTLE_MAX_SLEEPING writes per process and
+ * PID_THROTTLE_MAX_SLEEPING_ALL in all sleep at once. A write over budget
+ * past that goes through at once, its cost left owing in the process's
+ * bucket, so the process's later writes wait it off and its overall rate
+ * holds. Keep max_threads above PID_THROTTLE_MAX_SLEEPING_ALL.
+ *
+ * The table is a fixed array with open addressing and no locks: a slot is
+ * claimed with one CAS, each process's counters are one 64-bit word
+ * updated with a CAS loop, and the blocked check is a probe and a load.
+ */
+
+#ifndef SENTINELFS_PID_SCORE_H
+#define SENTINELFS_PID_SCORE_H
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define PID_TABLE_SIZE 4096            // Threads and processes tracked at once, power of two
+#define PID_TABLE_PROBE 32             // Slots searched before giving up on a PID
+#define PID_SCORE_TICK_HZ 4            // Counter clock
+#define PID_SCORE_HALFLIFE_TICKS 8     // 2 seconds
+#define PID_SCORE_MIN_WRITES 8         // Decayed writes before the entropy share counts
+#define PID_SCORE_FILE_RATE 4.0        // Files per second that count as mass file activity
+#define PID_SCORE_THRESHOLD_DEFAULT 75 // Percent
+#define PID_SCORE_FLAG_TTL 60          // Seconds a flag outlives the process's last attempt
+#define PID_SCORE_IDLE 60              // Seconds before an idle slot may be reused
+#define PID_THROTTLE_START_DEFAULT 25  // Percent
+#define PID_THROTTLE_FAST_MB 64.0      // MB/s allowed at the throttle start
+#define PID_THROTTLE_SLOW_MB 1.0       // MB/s allowed just below the threshold
+#define PID_THROTTLE_BURST (1 << 20)   // Bytes written at once before the bucket applies
+#define PID_THROTTLE_MAX_DELAY_MS 1000 // Longest single delay, keeps FUSE requests alive
+#define PID_THROTTLE_MAX_SLEEPING 2    // Writes of one process delayed at once
+#define PID_THROTTLE_MAX_SLEEPING_ALL 4 // ... of all processes, below libfuse's max_threads
+
+// threshold: percent (1-100) at which a process is flagged, 0 = scoring off.
+// throttle: percent at which its writes start being slowed, 0 = never.
+int pid_score_init(unsigned threshold, unsigned throttle);
+void pid_score_destroy(void);
+int pid_score_enabled(void);
+
+// O(1): is this process flagged? Refreshes the flag while it keeps trying.
+int pid_score_blocked(pid_t pid);
+// Same without refreshing the flag, for a verdict on what it did earlier
+int pid_score_flagged(pid_t pid);
+
+// Record one event. entropic: a high-entropy write nothing vouched for.
+// destroys: an unlink, rename over or truncate, the file's content is gone.
+void pid_score_read(pid_t pid, const struct stat *st);
+void pid_score_write(pid_t pid, const struct stat *st, off_t offset, int entropic);
+void pid_score_touch(pid_t pid, const struct stat *st, int destroys);
+// The process (thread group) of the thread pid a FUSE request comes from,
+// cached in the table; read from /proc each time with scoring off
+pid_t pid_score_process(pid_t pid);
+// Another detector caught the process: flag it whatever its score
+void pid_score_flag(pid_t pid, const char *why);
+// Charge a write of bytes to the process's token bucket; sleeps if the
+// bucket is empty and not too many writes sleep already. O(1), and free
+// for processes below the throttle start. Never fails the write.
+void pid_score_throttle(pid_t pid, size_t bytes);
+
+void pid_score_print_stats(FILE *out);
+
+#endif /* SENTINELFS_PID_SCORE_H */
@@ -0,0 +1,271 @@
+/*
+ * SentinelFS - Detection pipeline
+ *
+ * Per-stage counters are relaxed atomics (FUSE runs multi-threaded) and
+ * timing uses CLOCK_MONOTONIC, which is a vDSO call on Linux.
+ */
+
+#include "pipeline.h"
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    const sentinelfs_detector_t *det;
+    void *dl_handle;  // NULL for built-in detectors
+} registered_t;
+
+typedef struct {
+    const sentinelfs_detector_t *det;
+    void *state;
+    int initialized;
+    _Atomic unsigned long calls;
+    _Atomic unsigned long allows;
+    _Atomic unsigned long blocks;
+    _Atomic unsigned long suspects;
+    _Atomic uint64_t nanos;
+} stage_t;
+
+static registered_t registry[PIPELINE_MAX_DETECTORS];
+static size_t registry_count = 0;
+
+static stage_t stages[PIPELINE_MAX_STAGES];
+static size_t stage_count = 0;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static const registered_t *find_detector(const char *name) {
+    for (size_t i = 0; i < registry_count; i++) {
+        if (strcmp(registry[i].det->name, name) == 0) return &registry[i];
+    }
+    return NULL;
+}
+
+static int add_detector(const sentinelfs_detector_t *det, void *dl_handle) {
+    if (!det || det->abi_version != SENTINELFS_DETECTOR_ABI || !det->name || !det->inspect) {
+        fprintf(stderr, "Detector has wrong ABI version or missing fields\n");
+        return -1;
+    }
+    if (find_detector(det->name) || registry_count == PIPELINE_MAX_DETECTORS) {
+        fprintf(stderr, "Detector name repeated or too many detectors: %s\n", det->name);
+        return -1;
+    }
+
+    registry[registry_count].det = det;
+    registry[registry_count].dl_handle = dl_handle;
+    registry_count++;
+    return 0;
+}
+
+int pipeline_register(const sentinelfs_detector_t *detector) {
+    return add_detector(detector, NULL);
+}
+
+static int load_module(const char *path) {
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "Failed to load detector: %s\n", dlerror());
+        return -1;
+    }
+
+    sentinelfs_detector_fn get = (sentinelfs_detector_fn)dlsym(handle, SENTINELFS_DETECTOR_SYMBOL);
+    if (!get || add_detector(get(), handle) != 0) {
+        fprintf(stderr, "Not a SentinelFS detector: %s\n", path);
+        dlclose(handle);
+        return -1;
+    }
+    return 0;
+}
+
+static int is_module(const struct dirent *e) {
+    size_t n = strlen(e->d_name);
+    return n > 3 && strcmp(e->d_name + n - 3, ".so") == 0;
+}
+
+int pipeline_load_dir(const char *dir) {
+    struct dirent **list;
+    int n = scandir(dir, &list, is_module, alphasort);
+    if (n < 0) {
+        perror(dir);
+        return -1;
+    }
+
+    int loaded = 0;
+    for (int i = 0; i < n; i++) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", dir, list[i]->d_name);
+        if (loaded >= 0) {
+            loaded = load_module(path) == 0 ? loaded + 1 : -1;
+        }
+        free(list[i]);
+    }
+
+    free(list);
+    return loaded;
+}
+
+static int append_stage(const char *name) {
+    const registered_t *r = find_detector(name);
+    if (!r) {
+        fprintf(stderr, "Unknown pipeline stage: %s\n", name);
+        return -1;
+    }
+    if (pipeline_has_stage(name) || stage_count == PIPELINE_MAX_STAGES) {
+        fprintf(stderr, "Pipeline stage repeated or too many stages: %s\n", name);
+        return -1;
+    }
+
+    memset(&stages[stage_count], 0, sizeof(stages[0]));
+    stages[stage_count++].det = r->det;
+    return 0;
+}
+
+int pipeline_configure(const char *order, int append_modules) {
+    char *list = strdup(order);
+    if (!list) return -1;
+
+    stage_count = 0;
+    char *save = NULL;
+    for (char *name = strtok_r(list, ":", &save); name; name = strtok_r(NULL, ":", &save)) {
+        if (append_stage(name) != 0) {
+            free(list);
+            return -1;
+        }
+    }
+    free(list);
+
+    for (size_t i = 0; append_modules && i < registry_count; i++) {
+        const char *name = registry[i].det->name;
+        if (registry[i].dl_handle && !pipeline_has_stage(name) && append_stage(name) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void pipeline_remove(const char *name) {
+    for (size_t i = 0; i < stage_count; i++) {
+        if (strcmp(stages[i].det->name, name) == 0) {
+            memmove(&stages[i], &stages[i + 1], (stage_count - i - 1) * sizeof(stages[0]));
+            stage_count--;
+            return;
+        }
+    }
+}
+
+int pipeline_has_stage(const char *name) {
+    for (size_t i = 0; i < stage_count; i++) {
+        if (strcmp(stages[i].det->name, name) == 0) return 1;
+    }
+    return 0;
+}
+
+int pipeline_init(void) {
+    for (size_t i = 0; i < stage_count; i++) {
+        stage_t *s = &stages[i];
+        if (s->det->init && s->det->init(&s->state) != 0) {
+            fprintf(stderr, "[SentinelFS] Detector %s failed to initialize\n", s->det->name);
+            return -1;
+        }
+        s->initialized = 1;
+    }
+    return 0;
+}
+
+void pipeline_destroy(void) {
+    for (size_t i = 0; i < stage_count; i++) {
+        stage_t *s = &stages[i];
+        if (s->initialized && s->det->destroy) s->det->destroy(s->state);
+        s->initialized = 0;
+    }
+    for (size_t i = 0; i < registry_count; i++) {
+        if (registry[i].dl_handle) dlclose(registry[i].dl_handle);
+    }
+    stage_count = 0;
+    registry_count = 0;
+}
+
+static detector_verdict_t run_stage(stage_t *s, sentinelfs_write_t *write, double *confidence) {
+    *confidence = 1.0;
+    uint64_t start = now_ns();
+    detector_verdict_t v = s->det->inspect(s->state, write, confidence);
+    atomic_fetch_add_explicit(&s->nanos, now_ns() - start, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s->calls, 1, memory_order_relaxed);
+    return v;
+}
+
+detector_verdict_t pipeline_run(sentinelfs_write_t *write, const char **stage,
+                                double *confidence) {
+    detector_verdict_t verdict = DETECTOR_CONTINUE;
+    const char *suspect_stage = NULL;
+    double suspicion = 0.0;
+    size_t i = 0;
+
+    while (i < stage_count) {
+        stage_t *s = &stages[i++];
+        double c;
+        verdict = run_stage(s, write, &c);
+
+        if (verdict == DETECTOR_ALLOW || verdict == DETECTOR_BLOCK) {
+            atomic_fetch_add_explicit(verdict == DETECTOR_ALLOW ? &s->allows : &s->blocks, 1,
+                                      memory_order_relaxed);
+            *stage = s->det->name;
+            *confidence = c;
+            break;
+        }
+        if (verdict == DETECTOR_SUSPECT) {
+            atomic_fetch_add_explicit(&s->suspects, 1, memory_order_relaxed);
+            if (c > suspicion) {
+                suspicion = c;
+                suspect_stage = s->det->name;
+            }
+        }
+    }
+
+    // Nobody decided: the most confident suspicion, if strong enough, blocks
+    if (verdict != DETECTOR_ALLOW && verdict != DETECTOR_BLOCK) {
+        verdict = suspicion >= PIPELINE_BLOCK_CONFIDENCE ? DETECTOR_BLOCK : DETECTOR_ALLOW;
+        *stage = verdict == DETECTOR_BLOCK ? suspect_stage : NULL;
+        *confidence = suspicion;
+    }
+
+    // Stateful stages after the deciding one still need to see the data
+    // that is about to be written, or their per-file state drifts
+    if (verdict == DETECTOR_ALLOW) {
+        for (; i < stage_count; i++) {
+            double c;
+            if (stages[i].det->stateful) run_stage(&stages[i], write, &c);
+        }
+    }
+
+    return verdict;
+}
+
+void pipeline_print_order(FILE *out) {
+    for (size_t i = 0; i < stage_count; i++) {
+        fprintf(out, "%s%s", i ? " -> " : "", stages[i].det->name);
+    }
+    fprintf(out, "\n");
+}
+
+void pipeline_print_stats(FILE *out) {
+    fprintf(out, "  Pipeline stages:      calls     allow     block   suspect    avg us\n");
+    for (size_t i = 0; i < stage_count; i++) {
+        stage_t *s = &stages[i];
+        unsigned long calls = atomic_load(&s->calls);
+        double avg_us = calls ? atomic_load(&s->nanos) / 1000.0 / calls : 0.0;
+        fprintf(out, "    %-16s %10lu %9lu %9lu %9lu %9.2f\n", s->det->name, calls,
+                atomic_load(&s->allows), atomic_load(&s->blocks),
+                atomic_load(&s->suspects), avg_us);
+    }
+}
@@ -0,0 +1,49 @@
+/*
+ * SentinelFS - Detection pipeline
+ *
+ * A write is judged by an ordered list of detectors (sentinelfs_detector.h).
+ * Each either lets the write through (ALLOW), rejects it (BLOCK), passes it
+ * on (CONTINUE), or passes it on flagged (SUSPECT). A write that reaches
+ * the end of the pipeline is blocked only if some stage flagged it with
+ * enough confidence. The order is configurable, so cheap stages can run
+ * first and keep expensive ones (LibMagic) off the common path.
+ */
+
+#ifndef SENTINELFS_PIPELINE_H
+#define SENTINELFS_PIPELINE_H
+
+#include <stdio.h>
+
+#include "sentinelfs_detector.h"
+
+#define PIPELINE_MAX_STAGES 16
+#define PIPELINE_MAX_DETECTORS 32      // Built-in plus loaded modules
+#define PIPELINE_BLOCK_CONFIDENCE 0.5  // SUSPECT confidence that blocks at the end
+
+// Make a detector available to pipeline_configure
+int pipeline_register(const sentinelfs_detector_t *detector);
+// dlopen every *.so in dir (sorted by name) and register its detector.
+// Returns the number loaded, or -1 (reported to stderr) on any bad module.
+int pipeline_load_dir(const char *dir);
+
+// Build the pipeline from a ':'-separated list of detector names (FUSE's
+// -o parser already splits on commas). With append_modules, detectors
+// loaded from a directory but not named in order run last. Returns -1 and
+// reports to stderr on an unknown or repeated name.
+int pipeline_configure(const char *order, int append_modules);
+void pipeline_remove(const char *name);
+int pipeline_has_stage(const char *name);
+
+// init()/destroy() of the configured stages, at mount and unmount
+int pipeline_init(void);
+void pipeline_destroy(void);
+
+// Run the configured stages; returns DETECTOR_ALLOW or DETECTOR_BLOCK.
+// *stage and *confidence describe the deciding stage (NULL if none did).
+detector_verdict_t pipeline_run(sentinelfs_write_t *write, const char **stage,
+                                double *confidence);
+
+void pipeline_print_order(FILE *out);
+void pipeline_print_stats(FILE *out);
+
+#endif /* SENTINELFS_PIPELINE_H */
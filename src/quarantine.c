@@ -0,0 +1,298 @@
+/*
+ * SentinelFS - Quarantine write mode
+ *
+ * The shadow file is sparse: each write lands at its own offset, and a
+ * short sorted list of extents says which bytes it holds. A file is
+ * resolved with its inode_table set locked, so no write can slip in
+ * between the verdict and the copy.
+ */
+
+#include "quarantine.h"
+#include "backup.h"
+#include "inode_table.h"
+#include "pid_score.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define COPY_BUFFER (64 * 1024)
+
+typedef struct {
+    off_t start;
+    off_t end;
+} extent_t;
+
+typedef struct {
+    char path[PATH_MAX];         // The real file
+    char shadow_path[PATH_MAX];  // Empty once resolved
+    int shadow;
+    pid_t suspect;               // Process whose write was diverted last
+    pid_t writer;                // Process of the first write into the shadow
+    int shared;                  // Other processes wrote into it as well
+    size_t extents;
+    extent_t extent[QUARANTINE_EXTENTS];  // Sorted, disjoint
+} quarantine_t;
+
+static int enabled;
+static quarantine_judge_fn judge;
+static inode_table_t *table;
+static char *shadow_dir;
+static _Atomic long entries;  // Files with a shadow
+
+static struct {
+    _Atomic unsigned long diverted;    // Writes the pipeline blocked, kept in a shadow
+    _Atomic unsigned long writes;      // All writes into shadows
+    _Atomic unsigned long committed;   // Files whose shadow was copied in
+    _Atomic unsigned long discarded;   // Files whose shadow was dropped
+    _Atomic unsigned long kept;        // Files whose shadow was left for the operator
+    _Atomic unsigned long long bytes;  // Committed
+} qstats;
+
+// Merge [start, end) into the extent list; -1 if it is full
+static int add_extent(quarantine_t *q, off_t start, off_t end) {
+    size_t i = 0;
+    while (i < q->extents && q->extent[i].end < start) i++;
+    size_t j = i;
+    while (j < q->extents && q->extent[j].start <= end) {
+        if (q->extent[j].start < start) start = q->extent[j].start;
+        if (q->extent[j].end > end) end = q->extent[j].end;
+        j++;
+    }
+
+    if (i == j) {
+        if (q->extents == QUARANTINE_EXTENTS) return -1;
+        memmove(&q->extent[i + 1], &q->extent[i], (q->extents - i) * sizeof(extent_t));
+        q->extents++;
+    } else {
+        memmove(&q->extent[i + 1], &q->extent[j], (q->extents - j) * sizeof(extent_t));
+        q->extents -= j - i - 1;
+    }
+    q->extent[i].start = start;
+    q->extent[i].end = end;
+    return 0;
+}
+
+// Back up and overwrite the real file's extents with the shadow's
+static int commit(quarantine_t *q) {
+    int fd = open(q->path, O_WRONLY);
+    unsigned char *buf = malloc(COPY_BUFFER);
+    int err = fd == -1 ? errno : buf ? 0 : ENOMEM;
+
+    for (size_t i = 0; i < q->extents && !err; i++) {
+        extent_t *e = &q->extent[i];
+        struct stat st;
+        if (fstat(fd, &st) == -1) {
+            err = errno;
+            break;
+        }
+        backup_before_write(q->path, &st, e->start, e->end - e->start);
+
+        for (off_t o = e->start; o < e->end && !err;) {
+            size_t n = e->end - o < COPY_BUFFER ? (size_t)(e->end - o) : COPY_BUFFER;
+            ssize_t r = pread(q->shadow, buf, n, o);
+            if (r <= 0 || pwrite(fd, buf, r, o) != r) {
+                err = r < 0 ? errno : EIO;
+                break;
+            }
+            atomic_fetch_add_explicit(&qstats.bytes, r, memory_order_relaxed);
+            o += r;
+        }
+    }
+
+    free(buf);
+    if (fd != -1) close(fd);
+    if (err) {
+        fprintf(stderr, "[SentinelFS] Failed to commit quarantined writes to %s: %s (kept in %s)\n",
+                q->path, strerror(err), q->shadow_path);
+        return -err;
+    }
+    return 0;
+}
+
+// Does the pipeline clear every extent as the shadow holds it now? Any
+// error counts as no.
+static int cleared(quarantine_t *q) {
+    struct stat st;
+    unsigned char *buf = malloc(COPY_BUFFER);
+    int ok = buf && stat(q->path, &st) == 0;
+
+    for (size_t i = 0; i < q->extents && ok; i++) {
+        extent_t *e = &q->extent[i];
+        for (off_t o = e->start; o < e->end && ok;) {
+            size_t n = e->end - o < COPY_BUFFER ? (size_t)(e->end - o) : COPY_BUFFER;
+            ssize_t r = pread(q->shadow, buf, n, o);
+            ok = r > 0 && judge(q->path, buf, r, o, &st, q->suspect);
+            o += r;
+        }
+    }
+    free(buf);
+    return ok;
+}
+
+// Discard, commit, or keep for the operator; returns 1 if the real file changed
+static int resolve(quarantine_t *q) {
+    if (!q->shadow_path[0]) return 0;
+
+    int changed = 0;
+    int keep = 0;
+    if (pid_score_flagged(q->suspect) && q->shared) {
+        // Their writes are in there too, and may be all they have
+        atomic_fetch_add_explicit(&qstats.kept, 1, memory_order_relaxed);
+        fprintf(stderr, "[SentinelFS] Quarantined writes to %s kept in %s (process %d flagged, other writers too)\n",
+                q->path, q->shadow_path, (int)q->suspect);
+        keep = 1;
+    } else if (pid_score_flagged(q->suspect)) {
+        atomic_fetch_add_explicit(&qstats.discarded, 1, memory_order_relaxed);
+        fprintf(stderr, "[SentinelFS] Quarantined writes to %s discarded (process %d flagged)\n",
+                q->path, (int)q->suspect);
+    } else if (!cleared(q)) {
+        atomic_fetch_add_explicit(&qstats.kept, 1, memory_order_relaxed);
+        fprintf(stderr, "[SentinelFS] Quarantined writes to %s still blocked, kept in %s\n",
+                q->path, q->shadow_path);
+        keep = 1;
+    } else if (commit(q) == 0) {
+        atomic_fetch_add_explicit(&qstats.committed, 1, memory_order_relaxed);
+        fprintf(stderr, "[SentinelFS] Quarantined writes to %s committed\n", q->path);
+        changed = 1;
+    } else {
+        keep = 1;  // Left for the operator
+    }
+
+    close(q->shadow);
+    if (!keep) unlink(q->shadow_path);
+    q->shadow_path[0] = '\0';
+    atomic_fetch_sub_explicit(&entries, 1, memory_order_relaxed);
+    return changed;
+}
+
+static void evict(void *value) {
+    resolve(value);
+}
+
+int quarantine_init(const char *backup_dir, quarantine_judge_fn judge_fn) {
+    if (!backup_dir) return 0;
+
+    enabled = 1;
+    judge = judge_fn;
+    shadow_dir = strdup(backup_dir);
+    table = inode_table_create(QUARANTINE_FILES, sizeof(quarantine_t), evict);
+    return shadow_dir && table ? 0 : -1;
+}
+
+void quarantine_destroy(void) {
+    inode_table_destroy(table);
+    table = NULL;
+    free(shadow_dir);
+    shadow_dir = NULL;
+}
+
+int quarantine_enabled(void) {
+    return table != NULL;
+}
+
+int quarantine_pending(void) {
+    return table && atomic_load_explicit(&entries, memory_order_relaxed) > 0;
+}
+
+int quarantine_write(const char *full_path, const struct stat *st, const unsigned char *buf,
+                     size_t len, off_t offset, pid_t pid, int divert) {
+    if (!table || !S_ISREG(st->st_mode)) return divert ? -EIO : 0;
+    if (!divert && !quarantine_pending()) return 0;
+
+    int created;
+    quarantine_t *q = inode_table_get(table, st->st_dev, st->st_ino, divert, &created);
+    if (!q) return 0;
+
+    if (created) {
+        snprintf(q->path, sizeof(q->path), "%s", full_path);
+        snprintf(q->shadow_path, sizeof(q->shadow_path), "%s/quarantine-XXXXXX", shadow_dir);
+        q->shadow = mkstemp(q->shadow_path);
+        if (q->shadow == -1) {
+            int err = -errno;
+            q->shadow_path[0] = '\0';
+            inode_table_remove(table, q);
+            return err;
+        }
+        atomic_fetch_add_explicit(&entries, 1, memory_order_relaxed);
+        fprintf(stderr, "[SentinelFS] Quarantining writes to %s in %s\n", full_path, q->shadow_path);
+    }
+    if (divert) {
+        q->suspect = pid;
+        atomic_fetch_add_explicit(&qstats.diverted, 1, memory_order_relaxed);
+    }
+    pid_t process = pid_score_process(pid);
+    if (created) q->writer = process;
+    if (process != q->writer) q->shared = 1;
+
+    int res = -EIO;
+    if (add_extent(q, offset, offset + len) == 0 &&
+        pwrite(q->shadow, buf, len, offset) == (ssize_t)len) {
+        res = (int)len;
+        atomic_fetch_add_explicit(&qstats.writes, 1, memory_order_relaxed);
+    }
+    inode_table_put(table, q);
+    return res;
+}
+
+int quarantine_release(dev_t dev, ino_t ino) {
+    if (!quarantine_pending()) return 0;
+
+    quarantine_t *q = inode_table_get(table, dev, ino, 0, NULL);
+    if (!q) return 0;
+
+    int changed = resolve(q);
+    inode_table_remove(table, q);
+    return changed;
+}
+
+int quarantine_read(const struct stat *st, char *buf, size_t size, off_t offset, int res) {
+    if (!quarantine_pending() || res < 0 || !S_ISREG(st->st_mode)) return res;
+
+    quarantine_t *q = inode_table_get(table, st->st_dev, st->st_ino, 0, NULL);
+    if (!q) return res;
+
+    off_t end = offset + (off_t)size;
+    for (size_t i = 0; i < q->extents; i++) {
+        off_t s = q->extent[i].start > offset ? q->extent[i].start : offset;
+        off_t e = q->extent[i].end < end ? q->extent[i].end : end;
+        if (s >= e) continue;
+        if (e - offset > res) {
+            memset(buf + res, 0, e - offset - res);  // Past the real EOF
+            res = (int)(e - offset);
+        }
+        if (pread(q->shadow, buf + (s - offset), e - s, s) == -1) {
+            res = -errno;
+            break;
+        }
+    }
+    inode_table_put(table, q);
+    return res;
+}
+
+off_t quarantine_size(const struct stat *st) {
+    if (!quarantine_pending() || !S_ISREG(st->st_mode)) return st->st_size;
+
+    quarantine_t *q = inode_table_get(table, st->st_dev, st->st_ino, 0, NULL);
+    if (!q) return st->st_size;
+
+    off_t size = st->st_size;
+    if (q->extents && q->extent[q->extents - 1].end > size) size = q->extent[q->extents - 1].end;
+    inode_table_put(table, q);
+    return size;
+}
+
+void quarantine_print_stats(FILE *out) {
+    if (!enabled) {
+        fprintf(out, "  Quarantine: off\n");
+        return;
+    }
+    fprintf(out, "  Quarantine: %lu writes diverted (%lu into shadows), %lu files committed (%llu KB), %lu discarded, %lu kept, %ld pending\n",
+            atomic_load(&qstats.diverted), atomic_load(&qstats.writes),
+            atomic_load(&qstats.committed), atomic_load(&qstats.bytes) / 1024,
+            atomic_load(&qstats.discarded), atomic_load(&qstats.kept), atomic_load(&entries));
+}
@@ -0,0 +1,65 @@
+/*
+ * SentinelFS - Quarantine write mode (-o quarantine)
+ *
+ * Failing a write with -EIO breaks an application on a false positive and
+ * loses its data. In quarantine mode a write the pipeline blocks goes to a
+ * shadow file in the backup directory instead, at the same offset. The
+ * real file is left untouched and the application is told it succeeded.
+ * From then on every write to that file goes to the shadow too, so the
+ * writes stay in order. Reads and stat see the file as if the shadow were
+ * already committed.
+ *
+ * On release, the file is resolved. If the process whose write was
+ * diverted has been flagged in the meantime (pid_score.h), the shadow is
+ * discarded, unless other processes wrote into it too: then it is kept
+ * for the operator, as their writes would be lost with it. Otherwise the pipeline judges the shadow's extents again, as
+ * they are now: only if it clears all of them are they backed up and
+ * copied into the real file. If not, the shadow is kept in the backup
+ * directory for the operator, with each write at its offset, and the real
+ * file stays as it was. Not being flagged is no acquittal: a process that
+ * encrypts a single file may never be. Truncate, O_TRUNC, unlink and
+ * rename resolve the file first as well. Quarantine needs process scoring.
+ *
+ * Files that were never diverted pay one atomic load per write.
+ */
+
+#ifndef SENTINELFS_QUARANTINE_H
+#define SENTINELFS_QUARANTINE_H
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define QUARANTINE_FILES 256    // Files quarantined at once; eviction resolves the oldest
+#define QUARANTINE_EXTENTS 64   // Disjoint written ranges per file
+
+// Does the pipeline clear len bytes at offset of the file at path (st) if
+// pid writes them now? 1 = yes.
+typedef int (*quarantine_judge_fn)(const char *path, const unsigned char *buf, size_t len,
+                                   off_t offset, const struct stat *st, pid_t pid);
+
+// backup_dir: where shadow files go, NULL = mode off
+int quarantine_init(const char *backup_dir, quarantine_judge_fn judge);
+// Resolves every quarantined file
+void quarantine_destroy(void);
+int quarantine_enabled(void);
+// Cheap check before looking up a file: is anything quarantined at all?
+int quarantine_pending(void);
+
+// Write into the file's shadow. divert: the pipeline blocked this write,
+// start a quarantine if there is none. Returns len, 0 if the file is not
+// quarantined and divert is 0 (the caller writes it for real), or -errno.
+int quarantine_write(const char *full_path, const struct stat *st, const unsigned char *buf,
+                     size_t len, off_t offset, pid_t pid, int divert);
+// Discard, commit or keep the file's shadow. Returns 1 if the real file changed.
+int quarantine_release(dev_t dev, ino_t ino);
+
+// Lay the shadow's bytes over a read of the real file that returned res
+// bytes; returns the new count
+int quarantine_read(const struct stat *st, char *buf, size_t size, off_t offset, int res);
+// The file's size once its shadow is committed
+off_t quarantine_size(const struct stat *st);
+
+void quarantine_print_stats(FILE *out);
+
+#endif /* SENTINELFS_QUARANTINE_H */
@@ -0,0 +1,41 @@
+/*
+ * SentinelFS - Read-then-overwrite tracker
+ *
+ * The classic ransomware loop reads a whole file and writes it back
+ * encrypted. Every read pass a process starts at offset 0 is traced per
+ * (pid, inode): how far it has read contiguously, and the entropy of what
+ * it read, sampled from the first READ_TRACK_SAMPLE bytes of each read.
+ * The "overwrite" pipeline stage then blocks an overwrite of a file the
+ * writer has read in full once the new data's entropy exceeds what it read
+ * by READ_TRACK_MARGIN bits/byte.
+ *
+ * Traces live in a fixed inode_table, so memory is bounded and the least
+ * recently used trace is evicted: cost per read stays flat however many
+ * files are read. Reads that do not start at offset 0 never create a trace.
+ */
+
+#ifndef SENTINELFS_READ_TRACK_H
+#define SENTINELFS_READ_TRACK_H
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define READ_TRACK_FILES 4096  // (pid, inode) traces kept
+#define READ_TRACK_SAMPLE 4096 // Bytes of each read that are entropy-sampled
+#define READ_TRACK_MARGIN 0.5  // Bits/byte the overwrite must add to what was read
+
+// files: 0 = off
+int read_track_init(size_t files);
+void read_track_destroy(void);
+int read_track_enabled(void);
+
+// pid read len bytes of the file (st) at offset
+void read_track_read(pid_t pid, const struct stat *st, const unsigned char *buf, size_t len,
+                     off_t offset);
+// Has pid read the whole file? *entropy receives the entropy of what it read.
+int read_track_full(pid_t pid, const struct stat *st, double *entropy);
+
+void read_track_print_stats(FILE *out);
+
+#endif /* SENTINELFS_READ_TRACK_H */
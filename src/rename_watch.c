@@ -0,0 +1,196 @@
+/*
+ * SentinelFS - Mass-rename and extension-change detector
+ *
+ * A process or directory whose slot is taken over by a colliding key
+ * starts from an empty window; with RENAME_WATCH_SLOTS slots that only
+ * happens when a thousand of them rename at once.
+ */
+
+#define _GNU_SOURCE  // CLOCK_MONOTONIC_COARSE
+
+#include "rename_watch.h"
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    uint32_t tag;      // Destination extension (hash bits not used for the bin)
+    uint16_t changes;  // Renames that changed the extension to it
+    uint32_t sources;  // One bit per original extension (hashed) of those changes
+} target_t;
+
+typedef struct {
+    uint32_t second;   // Which second this bucket counts
+    target_t targets[RENAME_WATCH_TARGETS];
+} bucket_t;
+
+typedef struct {
+    uint64_t key;      // Process, or hash of the directory path; 0 = free
+    bucket_t ring[RENAME_WATCH_WINDOW];
+} window_t;
+
+typedef struct {
+    unsigned changes;  // To the destination extension
+    unsigned sources;  // Distinct original extensions, approximately
+} totals_t;
+
+static window_t by_pid[RENAME_WATCH_SLOTS];
+static window_t by_dir[RENAME_WATCH_SLOTS];
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned threshold;
+
+static struct {
+    _Atomic unsigned long renames;
+    _Atomic unsigned long changes;    // Extension changed
+    _Atomic unsigned long tripped;    // Renames refused as part of a mass rename
+    _Atomic unsigned long long nanos; // Spent in rename_watch_record
+} rstats;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// FNV-1a, ASCII case folded
+static uint64_t hash_name(const char *s, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (unsigned char)tolower((unsigned char)s[i])) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+static const char *base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// Extension of the last path component; a leading dot is a hidden file
+static uint64_t extension(const char *path) {
+    const char *base = base_name(path);
+    const char *dot = strrchr(base, '.');
+    if (!dot || dot == base) return 0;
+    return hash_name(dot + 1, strlen(dot + 1));
+}
+
+static uint64_t directory(const char *path) {
+    const char *slash = strrchr(path, '/');
+    uint64_t h = hash_name(path, slash ? (size_t)(slash - path) : 0);
+    return h ? h : 1;
+}
+
+static window_t *slot(window_t *table, uint64_t key) {
+    uint64_t h = key * 0x9e3779b97f4a7c15ull;
+    window_t *w = &table[(h >> 32) & (RENAME_WATCH_SLOTS - 1)];
+    if (w->key != key) {
+        memset(w, 0, sizeof(*w));
+        w->key = key;
+    }
+    return w;
+}
+
+// Committing a temporary file (rsync's .report.docx.XyZ12 -> report.docx,
+// report.docx.tmp -> report.docx): the new name starts the old one
+static int commits_temp(const char *from, const char *to) {
+    const char *f = base_name(from), *t = base_name(to);
+    size_t n = strlen(t);
+    return strncmp(f, t, n) == 0 || (f[0] == '.' && strncmp(f + 1, t, n) == 0);
+}
+
+// Add the extension change to this second's bucket and sum the window's
+// changes to the same destination extension. Another extension hashed to
+// the same bin within one second takes it over.
+static void count(window_t *w, uint32_t now, uint64_t target, uint32_t source, totals_t *t) {
+    size_t bin = target % RENAME_WATCH_TARGETS;
+    uint32_t tag = (uint32_t)(target >> 32);
+
+    bucket_t *b = &w->ring[now % RENAME_WATCH_WINDOW];
+    if (b->second != now) {
+        memset(b, 0, sizeof(*b));
+        b->second = now;
+    }
+    target_t *x = &b->targets[bin];
+    if (x->changes == 0 || x->tag != tag) {
+        memset(x, 0, sizeof(*x));
+        x->tag = tag;
+    }
+    if (x->changes < UINT16_MAX) x->changes++;
+    x->sources |= source;
+
+    uint32_t sources = 0;
+    memset(t, 0, sizeof(*t));
+    for (int i = 0; i < RENAME_WATCH_WINDOW; i++) {
+        b = &w->ring[i];
+        x = &b->targets[bin];
+        if (now - b->second >= RENAME_WATCH_WINDOW || x->changes == 0 || x->tag != tag) continue;
+        t->changes += x->changes;
+        sources |= x->sources;
+    }
+    t->sources = (unsigned)__builtin_popcount(sources);
+}
+
+static int mass_rename(const totals_t *t) {
+    return t->changes >= threshold && t->sources >= RENAME_WATCH_MIN_SOURCES;
+}
+
+void rename_watch_init(unsigned threshold_changes) {
+    threshold = threshold_changes;
+}
+
+int rename_watch_enabled(void) {
+    return threshold != 0;
+}
+
+int rename_watch_record(pid_t pid, const char *from, const char *to) {
+    if (!threshold) return 0;
+    uint64_t start = now_ns();
+
+    uint64_t from_ext = extension(from);
+    uint64_t to_ext = extension(to);
+    int changed = from_ext != to_ext && !commits_temp(from, to);
+    atomic_fetch_add_explicit(&rstats.renames, 1, memory_order_relaxed);
+    if (!changed) {
+        atomic_fetch_add_explicit(&rstats.nanos, now_ns() - start, memory_order_relaxed);
+        return 0;
+    }
+    uint32_t source = 1u << (from_ext & 31);
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    uint32_t now = (uint32_t)ts.tv_sec;
+
+    totals_t proc, in_dir;
+    pthread_mutex_lock(&lock);
+    count(slot(by_pid, (uint64_t)pid), now, to_ext, source, &proc);
+    count(slot(by_dir, directory(to)), now, to_ext, source, &in_dir);
+    pthread_mutex_unlock(&lock);
+
+    int tripped = mass_rename(&proc) || mass_rename(&in_dir);
+
+    atomic_fetch_add_explicit(&rstats.changes, 1, memory_order_relaxed);
+    if (tripped) {
+        atomic_fetch_add_explicit(&rstats.tripped, 1, memory_order_relaxed);
+        const totals_t *t = mass_rename(&proc) ? &proc : &in_dir;
+        fprintf(stderr, "[SentinelFS] ⚠️  Mass rename by %s: %u files renamed to one extension from %u extensions in %ds, refusing %s -> %s\n",
+                t == &proc ? "process" : "many processes in one directory", t->changes, t->sources,
+                RENAME_WATCH_WINDOW, from, to);
+    }
+    atomic_fetch_add_explicit(&rstats.nanos, now_ns() - start, memory_order_relaxed);
+    return tripped;
+}
+
+void rename_watch_print_stats(FILE *out) {
+    if (!threshold) {
+        fprintf(out, "  Rename watch: off\n");
+        return;
+    }
+    unsigned long renames = atomic_load(&rstats.renames);
+    fprintf(out, "  Rename watch: %lu renames, %lu extension changes, %lu refused, %.2f us per rename\n",
+            renames, atomic_load(&rstats.changes), atomic_load(&rstats.tripped),
+            renames ? atomic_load(&rstats.nanos) / 1000.0 / renames : 0.0);
+}
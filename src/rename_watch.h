@@ -0,0 +1,47 @@
+/*
+ * SentinelFS - Mass-rename and extension-change detector
+ *
+ * Renaming many files to a new extension (report.docx -> report.docx.locked)
+ * is one of the cheapest ransomware signals there is. Every extension
+ * change is counted twice: against the renaming process (its threads
+ * folded together) and against the destination directory, which catches
+ * work split over many processes. Each count is a sliding window of
+ * RENAME_WATCH_WINDOW one-second buckets in a fixed ring, binned by the
+ * destination extension.
+ *
+ * A rename trips the detector once either window holds at least the
+ * threshold of changes to its destination extension, coming from at least
+ * RENAME_WATCH_MIN_SOURCES different original extensions: files of every
+ * kind gaining the same new extension. A batch .txt -> .md rename has one
+ * source. Committing a temporary file (rsync's .report.docx.XyZ12 ->
+ * report.docx) is not an extension change at all: the new name starts the
+ * old one.
+ *
+ * Both tables are fixed, direct-mapped arrays, so a rename costs one
+ * hash of each name and one pass over two rings, whatever the history.
+ */
+
+#ifndef SENTINELFS_RENAME_WATCH_H
+#define SENTINELFS_RENAME_WATCH_H
+
+#include <stdio.h>
+#include <sys/types.h>
+
+#define RENAME_WATCH_WINDOW 10             // Seconds, one bucket each
+#define RENAME_WATCH_SLOTS 1024            // Processes and directories tracked, each
+#define RENAME_WATCH_TARGETS 8             // Destination extensions binned per second
+#define RENAME_WATCH_MIN_SOURCES 3         // Distinct original extensions among the changes
+#define RENAME_WATCH_THRESHOLD_DEFAULT 20  // Changes to one extension per window
+
+// threshold: changes to one extension per window that trip it, 0 = off
+void rename_watch_init(unsigned threshold);
+int rename_watch_enabled(void);
+
+// Count a rename of from to to (FUSE paths) by process pid (a thread group
+// id, see pid_score_process()). Returns 1 if it completes a mass-rename
+// pattern: the caller refuses it.
+int rename_watch_record(pid_t pid, const char *from, const char *to);
+
+void rename_watch_print_stats(FILE *out);
+
+#endif /* SENTINELFS_RENAME_WATCH_H */
@@ -11,8 +11,9 @@
  * Institution: National University of Sciences and Technology (NUST)
  * Department of Computer Science, Islamabad, Pakistan
  *
- * Compile: gcc -Wall -O2 sentinelfs.c `pkg-config fuse3 --cflags --libs` -lmagic -lm -o sentinelfs
- * Usage: ./sentinelfs <storage_path> <mount_point>
+ * Compile: make (sources in src/, links fuse3, libmagic, zlib, libm)
+ * Usage: ./sentinelfs <storage_path> <mount_point> [-o no_magic] [-o pipeline=...]
+ *        [-o detector_dir=...]
  */
 
 #define FUSE_USE_VERSION 31
@@ -29,21 +30,62 @@
 #include <sys/time.h>
 #include <dirent.h>
 #include <limits.h>
-#include <math.h>
 #include <magic.h>
+#include <math.h>
 #include <stddef.h>
 
+#include "backup.h"
+#include "backup_gc.h"
+#include "backup_io.h"
+#include "baseline.h"
+#include "canary.h"
+#include "entropy.h"
+#include "mime_cache.h"
+#include "pid_score.h"
+#include "pipeline.h"
+#include "quarantine.h"
+#include "read_track.h"
+#include "rename_watch.h"
+#include "stream_validators.h"
+#include "validators.h"
+#include "write_stage.h"
+
 // Config
 #define ENTROPY_THRESHOLD 7.5     // Anything above this is probably encrypted
-#define JIT_BACKUP_MAX_SIZE (50 * 1024 * 1024)  // 50MB limit to avoid latency spikes
 #define MAX_PATH 4096
-#define BACKUP_DIR ".sentinelfs_backups"
+#define STREAM_MAX_FILES 1024     // Files followed by the streaming container validators
+#define STATS_FILE "/.sentinelfs_stats"  // Read-only virtual file with live counters
+// Detection stage order. overwrite goes before entropy, which allows
+// anything at or below the threshold: mid-entropy overwrites matter too.
+#define DEFAULT_PIPELINE "zero:overwrite:entropy:sniffer:validator:magic"
 
 // Global context
 typedef struct {
     char *storage_path;
     char *backup_path;
     magic_t magic_cookie;  // LibMagic handle for deep file inspection
+    int no_magic;          // -o no_magic: structural validators only, no LibMagic fallback
+    int no_baseline;       // -o no_baseline: fixed entropy threshold only
+    char *pipeline;        // -o pipeline=a:b:c: detection stage order
+    char *detector_dir;    // -o detector_dir=DIR: load detector modules (*.so) from DIR
+    char *canaries;        // -o canaries=a:b: decoy files, paths inside the mount
+    int canary_seed;       // -o canary_seed: create decoy files at mount
+    int backup_method;     // -o backup_method=...: force one backup_method_t
+    unsigned backup_window;  // -o backup_window=SECS: back a file up at most once per window
+    int backup_compress;   // -o backup_compress: zlib-compress stored backup chunks
+    unsigned backup_max_mb;        // -o backup_max_mb=N: cap on the whole backup store
+    unsigned backup_max_age;       // -o backup_max_age=SECS: drop versions older than this
+    unsigned backup_max_versions;  // -o backup_max_versions=N: per file
+    unsigned backup_uid_quota_mb;  // -o backup_uid_quota_mb=N: per file owner
+    unsigned backup_gc_rate;       // -o backup_gc_rate=OPS: GC I/O operations per second
+    unsigned backup_rate_mb;       // -o backup_rate_mb=N: worker throughput cap, MB/s
+    int backup_ioprio;             // -o backup_ioprio=...: backup_ioprio_t
+    int backup_cache;              // -o backup_cache=...: backup_cache_t
+    unsigned pid_threshold;        // -o pid_threshold=PCT: flag processes scoring this, 0 = off
+    unsigned throttle;             // -o throttle=PCT: slow the writes of processes scoring this, 0 = off
+    unsigned rename_threshold;     // -o rename_threshold=N: renames to one extension per window, 0 = off
+    unsigned write_window;         // -o write_window=KB: stage small writes per file, 0 = off
+    int quarantine;                // -o quarantine: divert blocked writes to a shadow file
 } sentinelfs_context_t;
 
 static sentinelfs_context_t *global_ctx = NULL;
@@ -52,54 +94,70 @@ static sentinelfs_context_t *global_ctx = NULL;
 struct {
     unsigned long total_writes;
     unsigned long blocked_writes;
-    unsigned long backups_created;
-} stats = {0, 0, 0};
+    unsigned long validator_passes;   // Whitelisted by a structural validator
+    unsigned long validator_rejects;  // Known signature, broken structure
+    unsigned long magic_calls;        // magic_buffer() invocations
+    unsigned long stream_passes;      // Write consistent with a tracked container
+    unsigned long stream_violations;  // Write broke a tracked container's structure
+    unsigned long mime_cache_hits;    // LibMagic verdict served from the header-hash cache
+    unsigned long mime_cache_misses;
+} stats = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+// Mount options (-o name), parsed into the global context
+#define SENTINELFS_OPT(t, p, v) { t, offsetof(sentinelfs_context_t, p), v }
+
+static const struct fuse_opt sentinelfs_opts[] = {
+    SENTINELFS_OPT("no_magic", no_magic, 1),
+    SENTINELFS_OPT("no_baseline", no_baseline, 1),
+    SENTINELFS_OPT("pipeline=%s", pipeline, 0),
+    SENTINELFS_OPT("detector_dir=%s", detector_dir, 0),
+    SENTINELFS_OPT("canaries=%s", canaries, 0),
+    SENTINELFS_OPT("canary_seed", canary_seed, 1),
+    SENTINELFS_OPT("backup_method=auto", backup_method, BACKUP_AUTO),
+    SENTINELFS_OPT("backup_method=reflink", backup_method, BACKUP_CLONE),
+    SENTINELFS_OPT("backup_method=copy_file_range", backup_method, BACKUP_COPY_RANGE),
+    SENTINELFS_OPT("backup_method=sendfile", backup_method, BACKUP_SENDFILE),
+    SENTINELFS_OPT("backup_window=%u", backup_window, 0),
+    SENTINELFS_OPT("backup_compress", backup_compress, 1),
+    SENTINELFS_OPT("backup_max_mb=%u", backup_max_mb, 0),
+    SENTINELFS_OPT("backup_max_age=%u", backup_max_age, 0),
+    SENTINELFS_OPT("backup_max_versions=%u", backup_max_versions, 0),
+    SENTINELFS_OPT("backup_uid_quota_mb=%u", backup_uid_quota_mb, 0),
+    SENTINELFS_OPT("backup_gc_rate=%u", backup_gc_rate, 0),
+    SENTINELFS_OPT("backup_rate_mb=%u", backup_rate_mb, 0),
+    SENTINELFS_OPT("backup_ioprio=none", backup_ioprio, BACKUP_IOPRIO_NONE),
+    SENTINELFS_OPT("backup_ioprio=be", backup_ioprio, BACKUP_IOPRIO_BE),
+    SENTINELFS_OPT("backup_ioprio=idle", backup_ioprio, BACKUP_IOPRIO_IDLE),
+    SENTINELFS_OPT("backup_cache=keep", backup_cache, BACKUP_CACHE_KEEP),
+    SENTINELFS_OPT("backup_cache=drop", backup_cache, BACKUP_CACHE_DROP),
+    SENTINELFS_OPT("backup_cache=direct", backup_cache, BACKUP_CACHE_DIRECT),
+    SENTINELFS_OPT("pid_threshold=%u", pid_threshold, 0),
+    SENTINELFS_OPT("throttle=%u", throttle, 0),
+    SENTINELFS_OPT("rename_threshold=%u", rename_threshold, 0),
+    SENTINELFS_OPT("write_window=%u", write_window, 0),
+    SENTINELFS_OPT("quarantine", quarantine, 1),
+    FUSE_OPT_END
+};
 
 // Translate FUSE path to actual storage path
 static void translate_path(const char *path, char *full_path) {
     snprintf(full_path, MAX_PATH, "%s%s", global_ctx->storage_path, path);
 }
 
-// Generate backup filename with timestamp
-static void get_backup_path(const char *original_path, char *backup_path) {
-    char filename[256];
-    const char *basename = strrchr(original_path, '/');
-    basename = basename ? basename + 1 : original_path;
-
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-
-    snprintf(backup_path, MAX_PATH, "%s/%s.%ld.backup",
-             global_ctx->backup_path, basename, tv.tv_sec);
-}
-
-// Shannon entropy: H(X) = -Σ P(x) * log₂(P(x))
-// Returns 0-8, encrypted data is usually ~7.9-8.0
-static double calculate_entropy(const unsigned char *buffer, size_t len) {
-    if (len == 0) return 0.0;
-
-    unsigned long counts[256] = {0};  // Stack allocated for speed
-
-    // Count byte frequencies
-    for (size_t i = 0; i < len; i++) {
-        counts[buffer[i]]++;
-    }
-
-    // Calculate entropy
-    double entropy = 0.0;
-    for (int i = 0; i < 256; i++) {
-        if (counts[i] > 0) {
-            double probability = (double)counts[i] / len;
-            entropy -= probability * log2(probability);
-        }
-    }
-
-    return entropy;
-}
-
 // LibMagic deep file inspection - checks actual file structure, not just header bytes
-// Fixes the Phase I/II vulnerability where ransomware could fake headers
+// Fixes the Phase I/II vulnerability where ransomware could fake headers.
+// Verdicts are cached by header hash; text/ matches are not, since LibMagic
+// decides those from the whole buffer rather than the leading bytes.
 static int is_whitelisted_file(const unsigned char *buffer, size_t len) {
+    uint64_t key;
+    int cached = mime_cache_lookup(buffer, len, &key);
+    if (cached >= 0) {
+        stats.mime_cache_hits++;
+        return cached;
+    }
+    stats.mime_cache_misses++;
+    stats.magic_calls++;
+
     const char *mime = magic_buffer(global_ctx->magic_cookie, buffer, len);
 
     if (!mime) {
@@ -120,88 +178,296 @@ static int is_whitelisted_file(const unsigned char *buffer, size_t len) {
 
     for (int i = 0; safe_types[i] != NULL; i++) {
         if (strstr(mime, safe_types[i]) == mime) {
+            if (i != 0) mime_cache_insert(key, 1);  // safe_types[0] is "text/"
             return 1;  // Whitelisted
         }
     }
 
     // Also check for shebang (fixes false positives on shell wrappers like snap/snapctl)
     if (len >= 2 && buffer[0] == '#' && buffer[1] == '!') {
+        mime_cache_insert(key, 1);
         return 1;
     }
 
+    mime_cache_insert(key, 0);
     return 0;
 }
 
-// JIT backup - only backs up on first write, not on open
-// Saves 90% storage on read-heavy workloads
-static int create_jit_backup(const char *source_path) {
-    struct stat st;
-    if (stat(source_path, &st) == -1) {
+// Built-in detectors (sentinelfs_detector.h), run in the configured pipeline
+// order (-o pipeline=...). Further detectors can be loaded from -o detector_dir=.
+
+// High entropy is flagged, with confidence growing from 0.5 at the threshold
+// to 1.0 at 8 bits/byte; the whitelisting stages may still clear it. Below
+// the threshold, a write far above its type's and directory's baselines
+// (baseline.h) is flagged the same way.
+static detector_verdict_t entropy_inspect(void *state, sentinelfs_write_t *w, double *confidence) {
+    (void) state;
+    if (w->entropy < 0) {
+        w->entropy = calculate_entropy(w->buffer, w->len);
+    }
+    if (w->entropy <= ENTROPY_THRESHOLD) {
+        double sigmas;
+        if (baseline_judge(w->path, w->len, w->entropy, &sigmas) != BASELINE_DEVIANT) {
+            return DETECTOR_ALLOW;
+        }
+        *confidence = fmin(1.0, 0.5 * sigmas / BASELINE_SIGMAS);
+        fprintf(stderr, "[SentinelFS] Entropy %.2f is %.1f deviations above the baseline of %s\n",
+                w->entropy, sigmas, w->path);
+        return DETECTOR_SUSPECT;
+    }
+    *confidence = 0.5 + 0.5 * (w->entropy - ENTROPY_THRESHOLD) / (8.0 - ENTROPY_THRESHOLD);
+    return DETECTOR_SUSPECT;
+}
+
+static int magic_init(void **state) {
+    (void) state;
+    global_ctx->magic_cookie = magic_open(MAGIC_MIME_TYPE);
+    if (!global_ctx->magic_cookie) {
+        fprintf(stderr, "[SentinelFS] Failed to initialize LibMagic\n");
         return -1;
     }
 
-    // 50MB limit to avoid noticeable latency
-    if (st.st_size > JIT_BACKUP_MAX_SIZE) {
-        fprintf(stderr, "[SentinelFS] Skipping backup (file >50MB): %s\n", source_path);
-        return 0;
+    if (magic_load(global_ctx->magic_cookie, NULL) != 0) {
+        fprintf(stderr, "[SentinelFS] LibMagic error: %s\n",
+                magic_error(global_ctx->magic_cookie));
+        return -1;
     }
+    return 0;
+}
 
-    // Generate backup filename
-    char backup_path[MAX_PATH];
-    get_backup_path(source_path, backup_path);
+// Deep file inspection, only for buffers no validator recognised as broken.
+// New data whose high entropy is what its type and directory always see
+// (compressed content) is cleared without it; overwrites never are, nor is
+// data refilling a file truncated in this backup window.
+static detector_verdict_t magic_inspect(void *state, sentinelfs_write_t *w, double *confidence) {
+    (void) state;
+    (void) confidence;
+    if (w->flags & DETECTOR_FLAG_STRUCTURE_BROKEN) return DETECTOR_CONTINUE;
+
+    double sigmas;
+    if (w->entropy > ENTROPY_THRESHOLD && w->offset >= w->st->st_size && !backup_truncated(w->st) &&
+        baseline_judge(w->path, w->len, w->entropy, &sigmas) == BASELINE_EXPECTED) {
+        baseline_count_skip();
+        return DETECTOR_ALLOW;
+    }
+    return is_whitelisted_file(w->buffer, w->len) ? DETECTOR_ALLOW : DETECTOR_CONTINUE;
+}
 
-    // Copy file
-    FILE *src = fopen(source_path, "rb");
-    if (!src) return -1;
+static void magic_destroy(void *state) {
+    (void) state;
+    magic_close(global_ctx->magic_cookie);
+    global_ctx->magic_cookie = NULL;
+}
 
-    FILE *dst = fopen(backup_path, "wb");
-    if (!dst) {
-        fclose(src);
+// Zero-filled (or otherwise single-byte) buffers: hole filling, preallocation
+static detector_verdict_t zero_inspect(void *state, sentinelfs_write_t *w, double *confidence) {
+    (void) state;
+    (void) confidence;
+    if (w->len > 0 && memcmp(w->buffer, w->buffer + 1, w->len - 1) == 0) {
+        return DETECTOR_ALLOW;
+    }
+    return DETECTOR_CONTINUE;
+}
+
+static int sniffer_init(void **state) {
+    (void) state;
+    if (stream_validators_init(STREAM_MAX_FILES) != 0) {
+        fprintf(stderr, "[SentinelFS] Failed to allocate stream validator table\n");
         return -1;
     }
+    return 0;
+}
 
-    char buffer[8192];
-    size_t bytes;
-    while ((bytes = fread(buffer, 1, sizeof(buffer), src)) > 0) {
-        fwrite(buffer, 1, bytes, dst);
+// Compressed containers followed across writes (PNG, JPEG, MP4, ZIP, gzip)
+static detector_verdict_t sniffer_inspect(void *state, sentinelfs_write_t *w, double *confidence) {
+    (void) state;
+    (void) confidence;
+    const char *format = NULL;
+    stream_result_t stream = stream_check(w->st->st_dev, w->st->st_ino, w->buffer, w->len,
+                                          w->offset, &format);
+    if (stream == STREAM_OK) {
+        stats.stream_passes++;
+        return DETECTOR_ALLOW;
+    }
+    if (stream == STREAM_VIOLATION) {
+        stats.stream_violations++;
+        w->flags |= DETECTOR_FLAG_STRUCTURE_BROKEN;  // Skip LibMagic, entropy decides
+        fprintf(stderr, "[SentinelFS] Structure check failed (%s stream broken at offset %lld)\n",
+                format, (long long)w->offset);
     }
+    return DETECTOR_CONTINUE;
+}
 
-    fclose(src);
-    fclose(dst);
+static void sniffer_destroy(void *state) {
+    (void) state;
+    stream_validators_destroy();
+}
 
-    stats.backups_created++;
-    fprintf(stderr, "[SentinelFS] JIT Backup created: %s -> %s\n", source_path, backup_path);
+// Structural validation of known formats (bounded, no LibMagic)
+static detector_verdict_t validator_inspect(void *state, sentinelfs_write_t *w, double *confidence) {
+    (void) state;
+    (void) confidence;
+    if (w->flags & DETECTOR_FLAG_STRUCTURE_BROKEN) return DETECTOR_CONTINUE;
+
+    const char *format = NULL;
+    validate_result_t verdict = validate_structure(w->buffer, w->len, &format);
+    if (verdict == VALIDATE_OK) {
+        stats.validator_passes++;
+        return DETECTOR_ALLOW;
+    }
+    if (verdict == VALIDATE_BAD) {
+        stats.validator_rejects++;
+        w->flags |= DETECTOR_FLAG_STRUCTURE_BROKEN;
+        fprintf(stderr, "[SentinelFS] Structure check failed (%s header, invalid body)\n", format);
+    }
+    return DETECTOR_CONTINUE;
+}
 
+static int overwrite_init(void **state) {
+    (void) state;
+    if (read_track_init(READ_TRACK_FILES) != 0) {
+        fprintf(stderr, "[SentinelFS] Failed to allocate the read tracking table\n");
+        return -1;
+    }
     return 0;
 }
 
-// Main detection logic: LibMagic first, then entropy check
-static int detect_ransomware(const unsigned char *buffer, size_t len) {
+// The writer read this whole file and now overwrites it with clearly more
+// random data than it read: encrypting it in place (read_track.h). Writing
+// it back after truncating it is the same thing.
+static detector_verdict_t overwrite_inspect(void *state, sentinelfs_write_t *w, double *confidence) {
+    (void) state;
+    (void) confidence;
+    double before;
+    if ((w->offset >= w->st->st_size && !backup_truncated(w->st)) ||
+        !read_track_full(w->pid, w->st, &before)) {
+        return DETECTOR_CONTINUE;
+    }
+    if (w->entropy < 0) {
+        w->entropy = calculate_entropy(w->buffer, w->len);
+    }
+    if (w->entropy <= before + READ_TRACK_MARGIN) {
+        return DETECTOR_CONTINUE;
+    }
+    fprintf(stderr, "[SentinelFS] Overwrite after full read: entropy %.2f, was %.2f\n",
+            w->entropy, before);
+    return DETECTOR_BLOCK;
+}
+
+static void overwrite_destroy(void *state) {
+    (void) state;
+    read_track_destroy();
+}
+
+// The sniffer is stateful, so it still sees writes an earlier stage allowed
+static const sentinelfs_detector_t builtin_detectors[] = {
+    { SENTINELFS_DETECTOR_ABI, "entropy",   0, NULL,         entropy_inspect,   NULL },
+    { SENTINELFS_DETECTOR_ABI, "magic",     0, magic_init,   magic_inspect,     magic_destroy },
+    { SENTINELFS_DETECTOR_ABI, "zero",      0, NULL,         zero_inspect,      NULL },
+    { SENTINELFS_DETECTOR_ABI, "sniffer",   1, sniffer_init, sniffer_inspect,   sniffer_destroy },
+    { SENTINELFS_DETECTOR_ABI, "validator", 0, NULL,         validator_inspect, NULL },
+    { SENTINELFS_DETECTOR_ABI, "overwrite", 0, overwrite_init, overwrite_inspect, overwrite_destroy },
+};
+
+// Main detection logic: run the write through the detector pipeline
+static int detect_ransomware(const char *path, const unsigned char *buffer, size_t len,
+                             off_t offset, const struct stat *st, pid_t pid) {
     stats.total_writes++;
 
-    // Step 1: Deep file inspection
-    if (is_whitelisted_file(buffer, len)) {
-        return 0;  // Safe, allowed
-    }
+    sentinelfs_write_t w = { buffer, len, offset, path, st, pid, 0, -1.0 };
+    const char *stage;
+    double confidence;
+    detector_verdict_t verdict = pipeline_run(&w, &stage, &confidence);
 
-    // Step 2: Entropy check
-    double entropy = calculate_entropy(buffer, len);
+    // High entropy that no stage vouched for counts against the process
+    pid_score_write(w.pid, st, offset, verdict == DETECTOR_BLOCK && w.entropy > ENTROPY_THRESHOLD);
+    if (verdict == DETECTOR_ALLOW) {
+        baseline_learn(path, len, w.entropy);
+    }
 
-    if (entropy > ENTROPY_THRESHOLD) {
+    if (verdict == DETECTOR_BLOCK) {
         stats.blocked_writes++;
-        fprintf(stderr, "[SentinelFS] ⚠️  RANSOMWARE DETECTED! Entropy: %.2f (threshold: %.1f)\n",
-                entropy, ENTROPY_THRESHOLD);
+        char entropy[64] = "";
+        if (w.entropy >= 0) {
+            snprintf(entropy, sizeof(entropy), ", entropy: %.2f (threshold: %.1f)",
+                     w.entropy, ENTROPY_THRESHOLD);
+        }
+        fprintf(stderr, "[SentinelFS] ⚠️  RANSOMWARE DETECTED! Stage: %s (confidence %.2f)%s\n",
+                stage, confidence, entropy);
         return -EIO;  // Block the write
     }
 
     return 0;  // Allowed
 }
 
+// Quarantine release: the pipeline judges a shadow's bytes again, as a
+// fresh write but without counting them against the process or learning
+// from them a second time (quarantine_judge_fn)
+static int quarantine_judge(const char *full_path, const unsigned char *buf, size_t len,
+                            off_t offset, const struct stat *st, pid_t pid) {
+    const char *path = full_path + strlen(global_ctx->storage_path);
+    sentinelfs_write_t w = { buf, len, offset, path, st, pid, 0, -1.0 };
+    const char *stage;
+    double confidence;
+    return pipeline_run(&w, &stage, &confidence) == DETECTOR_ALLOW;
+}
+
+// A flagged process may not write or destroy anything (pid_score.h)
+static int refused(void) {
+    return pid_score_blocked(fuse_get_context()->pid);
+}
+
+// Staged and quarantined writes land before the file is truncated,
+// replaced or removed; st is refreshed if they changed it
+static void land_staged(const char *full_path, struct stat *st) {
+    int landed = write_stage_flush(st->st_dev, st->st_ino, 0, 0);
+    landed |= quarantine_release(st->st_dev, st->st_ino);
+    if (landed) {
+        stat(full_path, st);
+    }
+}
+
+// Counters, printed at shutdown and served live through STATS_FILE
+static void print_stats(FILE *out) {
+    fprintf(out, "  Total writes: %lu\n", stats.total_writes);
+    fprintf(out, "  Blocked writes: %lu (%.2f%%)\n", stats.blocked_writes,
+            stats.total_writes > 0 ? (100.0 * stats.blocked_writes / stats.total_writes) : 0.0);
+    backup_print_stats(out);
+    backup_gc_print_stats(out);
+    backup_io_print_stats(out);
+    pid_score_print_stats(out);
+    read_track_print_stats(out);
+    rename_watch_print_stats(out);
+    canary_print_stats(out);
+    write_stage_print_stats(out);
+    quarantine_print_stats(out);
+    baseline_print_stats(out);
+    fprintf(out, "  Validator passes: %lu\n", stats.validator_passes);
+    fprintf(out, "  Validator rejects: %lu\n", stats.validator_rejects);
+    fprintf(out, "  LibMagic calls: %lu\n", stats.magic_calls);
+    fprintf(out, "  Stream passes: %lu\n", stats.stream_passes);
+    fprintf(out, "  Stream violations: %lu\n", stats.stream_violations);
+
+    unsigned long lookups = stats.mime_cache_hits + stats.mime_cache_misses;
+    fprintf(out, "  MIME cache hits: %lu, misses: %lu (%.2f%% hit rate)\n",
+            stats.mime_cache_hits, stats.mime_cache_misses,
+            lookups > 0 ? (100.0 * stats.mime_cache_hits / lookups) : 0.0);
+    pipeline_print_stats(out);
+}
+
 // FUSE operations
 
 static int sentinelfs_getattr(const char *path, struct stat *stbuf,
                               struct fuse_file_info *fi) {
     (void) fi;
+
+    if (strcmp(path, STATS_FILE) == 0) {
+        memset(stbuf, 0, sizeof(*stbuf));
+        stbuf->st_mode = S_IFREG | 0444;
+        stbuf->st_nlink = 1;
+        return 0;  // Size unknown up front, served with direct_io
+    }
+
     char full_path[MAX_PATH];
     translate_path(path, full_path);
 
@@ -209,6 +475,12 @@ static int sentinelfs_getattr(const char *path, struct stat *stbuf,
         return -errno;
     }
 
+    /* The size must include writes still staged or quarantined */
+    if (write_stage_flush(stbuf->st_dev, stbuf->st_ino, 0, 0) && lstat(full_path, stbuf) == -1) {
+        return -errno;
+    }
+    stbuf->st_size = quarantine_size(stbuf);
+
     return 0;
 }
 
@@ -244,21 +516,69 @@ static int sentinelfs_readdir(const char *path, void *buf, fuse_fill_dir_t fille
 }
 
 static int sentinelfs_open(const char *path, struct fuse_file_info *fi) {
+    if (strcmp(path, STATS_FILE) == 0) {
+        if ((fi->flags & O_ACCMODE) != O_RDONLY) {
+            return -EACCES;
+        }
+        fi->direct_io = 1;
+        return 0;
+    }
+
     char full_path[MAX_PATH];
     translate_path(path, full_path);
 
+    /* O_TRUNC destroys the whole file before any write reaches us */
+    struct stat st;
+    int truncates = (fi->flags & O_TRUNC) && stat(full_path, &st) == 0;
+    if (truncates) {
+        if (refused() || canary_check(&st, fuse_get_context()->pid, path, "O_TRUNC")) {
+            return -EIO;
+        }
+        land_staged(full_path, &st);
+        backup_before_truncate(full_path, &st, 0);
+    }
+
     int fd = open(full_path, fi->flags);
     if (fd == -1) {
         return -errno;
     }
 
+    if (truncates && S_ISREG(st.st_mode)) {
+        pid_score_touch(fuse_get_context()->pid, &st, st.st_size > 0);
+    }
+
     close(fd);
     return 0;
 }
 
+// Render the counters and hand out the requested slice
+static int read_stats_file(char *buf, size_t size, off_t offset) {
+    char *text = NULL;
+    size_t text_len = 0;
+    FILE *out = open_memstream(&text, &text_len);
+    if (!out) {
+        return -ENOMEM;
+    }
+    print_stats(out);
+    fclose(out);
+
+    int res = 0;
+    if ((size_t)offset < text_len) {
+        res = (int)(text_len - offset < size ? text_len - offset : size);
+        memcpy(buf, text + offset, res);
+    }
+    free(text);
+    return res;
+}
+
 static int sentinelfs_read(const char *path, char *buf, size_t size, off_t offset,
                            struct fuse_file_info *fi) {
     (void) fi;
+
+    if (strcmp(path, STATS_FILE) == 0) {
+        return read_stats_file(buf, size, offset);
+    }
+
     char full_path[MAX_PATH];
     translate_path(path, full_path);
 
@@ -267,10 +587,88 @@ static int sentinelfs_read(const char *path, char *buf, size_t size, off_t offse
         return -errno;
     }
 
+    struct stat st;
+    int known = (write_stage_pending() || quarantine_pending() || pid_score_enabled() ||
+                 read_track_enabled()) && fstat(fd, &st) == 0;
+
+    /* Staged writes this read would miss land first */
+    if (known) {
+        write_stage_flush(st.st_dev, st.st_ino, offset, size);
+    }
+
     int res = pread(fd, buf, size, offset);
     if (res == -1) {
         res = -errno;
     }
+    if (known) {
+        res = quarantine_read(&st, buf, size, offset, res);
+    }
+
+    /* What a process read, it may later overwrite */
+    if (res > 0 && known) {
+        pid_t pid = fuse_get_context()->pid;
+        pid_score_read(pid, &st);
+        read_track_read(pid, &st, (const unsigned char *)buf, res, offset);
+    }
+
+    close(fd);
+    return res;
+}
+
+// Back up, inspect and write one buffer: a write too large to stage, or a
+// staged run landing (write_stage_flush_fn)
+static int write_checked(const char *path, const unsigned char *buf, size_t size,
+                         off_t offset, pid_t pid) {
+    char full_path[MAX_PATH];
+    translate_path(path, full_path);
+
+    int fd = open(full_path, O_WRONLY);
+    if (fd == -1) {
+        return -errno;
+    }
+
+    /* Inode identity keys the per-file detector state */
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        int err = -errno;
+        close(fd);
+        return err;
+    }
+
+    /* Nobody has a reason to write to a canary */
+    if (canary_check(&st, pid, path, "write")) {
+        stats.total_writes++;
+        stats.blocked_writes++;
+        close(fd);
+        return -EIO;
+    }
+
+    /* Phase IV: JIT Backup, waits only until the overwritten range is saved */
+    backup_before_write(full_path, &st, offset, size);
+
+    /* Phase III/IV: Ransomware Detection */
+    int detection_result = detect_ransomware(path, buf, size, offset, &st, pid);
+    if (detection_result != 0) {
+        /* Quarantine mode: the real file stays untouched until release */
+        if (quarantine_enabled()) {
+            detection_result = quarantine_write(full_path, &st, buf, size, offset, pid, 1);
+        }
+        close(fd);
+        return detection_result;  /* BLOCK write, return -EIO to application */
+    }
+
+    /* A quarantined file takes every later write too, so they stay in order */
+    int res = quarantine_write(full_path, &st, buf, size, offset, pid, 0);
+    if (res != 0) {
+        close(fd);
+        return res;
+    }
+
+    /* Write is ALLOWED, pass through to underlying filesystem */
+    res = pwrite(fd, buf, size, offset);
+    if (res == -1) {
+        res = -errno;
+    }
 
     close(fd);
     return res;
@@ -286,32 +684,55 @@ static int sentinelfs_read(const char *path, char *buf, size_t size, off_t offse
 static int sentinelfs_write(const char *path, const char *buf, size_t size,
                             off_t offset, struct fuse_file_info *fi) {
     (void) fi;
-    char full_path[MAX_PATH];
-    translate_path(path, full_path);
+    pid_t pid = fuse_get_context()->pid;
+
+    /* Flagged process: refused before any work, O(1) */
+    if (pid_score_blocked(pid)) {
+        stats.total_writes++;
+        stats.blocked_writes++;
+        return -EIO;
+    }
+    /* Suspicious but not flagged: slowed down by its token bucket */
+    pid_score_throttle(pid, size);
+
+    /* Small writes are inspected together once their run is complete */
+    if (write_stage_enabled()) {
+        char full_path[MAX_PATH];
+        translate_path(path, full_path);
 
-    /* Phase IV: JIT Backup (only on first write, offset == 0 heuristic) */
-    if (offset == 0) {
         struct stat st;
-        if (stat(full_path, &st) == 0 && st.st_size > 0) {
-            /* File exists and has content, backup before overwriting */
-            create_jit_backup(full_path);
+        if (stat(full_path, &st) == -1) {
+            return -errno;
+        }
+        if (canary_check(&st, pid, path, "write")) {
+            stats.total_writes++;
+            stats.blocked_writes++;
+            return -EIO;
+        }
+        int staged = write_stage_write(&st, path, buf, size, offset, pid);
+        if (staged != 0) {
+            return staged < 0 ? staged : (int)size;
         }
     }
 
-    /* Phase III/IV: Ransomware Detection */
-    int detection_result = detect_ransomware((const unsigned char *)buf, size);
-    if (detection_result != 0) {
-        return detection_result;  /* BLOCK write, return -EIO to application */
-    }
+    return write_checked(path, (const unsigned char *)buf, size, offset, pid);
+}
 
-    /* Write is ALLOWED, pass through to underlying filesystem */
-    int fd = open(full_path, O_WRONLY);
+// Staged writes must be on disk, and any verdict on them reported, before
+// fsync or close returns
+static int sentinelfs_fsync(const char *path, int datasync, struct fuse_file_info *fi) {
+    (void) fi;
+    char full_path[MAX_PATH];
+    translate_path(path, full_path);
+
+    int fd = open(full_path, O_RDONLY);
     if (fd == -1) {
         return -errno;
     }
 
-    int res = pwrite(fd, buf, size, offset);
-    if (res == -1) {
+    struct stat st;
+    int res = fstat(fd, &st) == 0 ? write_stage_sync(st.st_dev, st.st_ino) : -errno;
+    if (res == 0 && (datasync ? fdatasync(fd) : fsync(fd)) == -1) {
         res = -errno;
     }
 
@@ -319,16 +740,64 @@ static int sentinelfs_write(const char *path, const char *buf, size_t size,
     return res;
 }
 
+static int sentinelfs_flush(const char *path, struct fuse_file_info *fi) {
+    (void) fi;
+    if (!write_stage_pending()) {
+        return 0;
+    }
+
+    char full_path[MAX_PATH];
+    translate_path(path, full_path);
+
+    struct stat st;
+    if (stat(full_path, &st) == -1) {
+        return 0;  // Gone, or the stats file: nothing staged under this name
+    }
+    return write_stage_sync(st.st_dev, st.st_ino);
+}
+
+// Last close of an open file: its quarantined writes are committed or discarded
+static int sentinelfs_release(const char *path, struct fuse_file_info *fi) {
+    (void) fi;
+    if (!quarantine_pending()) {
+        return 0;
+    }
+
+    char full_path[MAX_PATH];
+    translate_path(path, full_path);
+
+    struct stat st;
+    if (stat(full_path, &st) == 0) {
+        quarantine_release(st.st_dev, st.st_ino);
+    }
+    return 0;
+}
+
 static int sentinelfs_create(const char *path, mode_t mode, struct fuse_file_info *fi) {
     (void) fi;
     char full_path[MAX_PATH];
     translate_path(path, full_path);
 
+    /* creat() truncates a file that already exists */
+    struct stat st;
+    int truncates = stat(full_path, &st) == 0;
+    if (truncates) {
+        if (refused() || canary_check(&st, fuse_get_context()->pid, path, "O_TRUNC")) {
+            return -EIO;
+        }
+        land_staged(full_path, &st);
+        backup_before_truncate(full_path, &st, 0);
+    }
+
     int fd = creat(full_path, mode);
     if (fd == -1) {
         return -errno;
     }
 
+    if (truncates && S_ISREG(st.st_mode)) {
+        pid_score_touch(fuse_get_context()->pid, &st, st.st_size > 0);
+    }
+
     close(fd);
     return 0;
 }
@@ -348,11 +817,31 @@ static int sentinelfs_unlink(const char *path) {
     char full_path[MAX_PATH];
     translate_path(path, full_path);
 
-    if (unlink(full_path) == -1) {
-        return -errno;
+    if (refused()) {
+        return -EIO;
     }
 
-    return 0;
+    /* Keep the last link's content: a hard link, no data copied */
+    struct stat st;
+    int known = lstat(full_path, &st) == 0;
+    if (known && canary_check(&st, fuse_get_context()->pid, path, "unlink")) {
+        return -EIO;
+    }
+    if (known) {
+        land_staged(full_path, &st);
+    }
+    uint64_t preimage = known ? backup_before_remove(full_path, &st) : 0;
+
+    int res = unlink(full_path) == -1 ? -errno : 0;
+
+    if (known) {
+        backup_after_remove(full_path, &st, preimage, res);
+    }
+    if (known && res == 0 && S_ISREG(st.st_mode)) {
+        pid_score_touch(fuse_get_context()->pid, &st, 1);
+    }
+
+    return res;
 }
 
 static int sentinelfs_rmdir(const char *path) {
@@ -374,11 +863,54 @@ static int sentinelfs_rename(const char *from, const char *to, unsigned int flag
     translate_path(from, full_from);
     translate_path(to, full_to);
 
-    if (rename(full_from, full_to) == -1) {
-        return -errno;
+    pid_t pid = fuse_get_context()->pid;
+    if (pid_score_blocked(pid)) {
+        return -EIO;
     }
 
-    return 0;
+    /* Moving a canary away, or replacing one */
+    if (canary_armed()) {
+        struct stat canary_st;
+        if ((lstat(full_from, &canary_st) == 0 && canary_check(&canary_st, pid, from, "rename")) ||
+            (lstat(full_to, &canary_st) == 0 && canary_check(&canary_st, pid, to, "rename over"))) {
+            return -EIO;
+        }
+    }
+
+    /* Many files renamed to new extensions in a short time: refused, and the process flagged */
+    if (rename_watch_record(pid_score_process(pid), from, to)) {
+        pid_score_flag(pid, "mass rename");
+        return -EIO;
+    }
+
+    /* Renaming over a file destroys it just like unlink */
+    struct stat st, from_st;
+    int replaced = strcmp(full_from, full_to) != 0 && lstat(full_to, &st) == 0;
+    if (replaced) {
+        land_staged(full_to, &st);
+    }
+    uint64_t preimage = replaced ? backup_before_remove(full_to, &st) : 0;
+
+    /* A staged run names the file by its old path */
+    int known = (pid_score_enabled() || write_stage_pending()) && lstat(full_from, &from_st) == 0;
+    if (known) {
+        land_staged(full_from, &from_st);
+    }
+    int scored = known && pid_score_enabled() && S_ISREG(from_st.st_mode);
+
+    int res = rename(full_from, full_to) == -1 ? -errno : 0;
+
+    if (replaced) {
+        backup_after_remove(full_to, &st, preimage, res);
+    }
+    if (res == 0 && scored) {
+        pid_score_touch(pid, &from_st, 0);
+        if (replaced && S_ISREG(st.st_mode)) {
+            pid_score_touch(pid, &st, 1);
+        }
+    }
+
+    return res;
 }
 
 static int sentinelfs_chmod(const char *path, mode_t mode, struct fuse_file_info *fi) {
@@ -410,31 +942,83 @@ static int sentinelfs_truncate(const char *path, off_t size, struct fuse_file_in
     char full_path[MAX_PATH];
     translate_path(path, full_path);
 
+    if (refused()) {
+        return -EIO;
+    }
+
+    /* Save what is about to be cut off: in-flight backup or journaled tail */
+    struct stat st;
+    int known = stat(full_path, &st) == 0;
+    if (known && canary_check(&st, fuse_get_context()->pid, path, "truncate")) {
+        return -EIO;
+    }
+    if (known) {
+        land_staged(full_path, &st);
+        backup_before_truncate(full_path, &st, size);
+    }
+
     if (truncate(full_path, size) == -1) {
         return -errno;
     }
 
+    if (known && S_ISREG(st.st_mode)) {
+        pid_score_touch(fuse_get_context()->pid, &st, size < st.st_size);
+    }
+
     return 0;
 }
 
-// Init: setup LibMagic
+// Init: start the detectors (LibMagic, stream tables, loaded modules)
 static void *sentinelfs_init(struct fuse_conn_info *conn, struct fuse_config *cfg) {
     (void) conn;
     cfg->kernel_cache = 0;  // No caching for security
 
-    global_ctx->magic_cookie = magic_open(MAGIC_MIME_TYPE);
-    if (!global_ctx->magic_cookie) {
-        fprintf(stderr, "[SentinelFS] Failed to initialize LibMagic\n");
+    if (pipeline_init() != 0) {
         exit(1);
     }
 
-    if (magic_load(global_ctx->magic_cookie, NULL) != 0) {
-        fprintf(stderr, "[SentinelFS] LibMagic error: %s\n",
-                magic_error(global_ctx->magic_cookie));
+    baseline_init(!global_ctx->no_baseline);
+
+    if (pid_score_init(global_ctx->pid_threshold, global_ctx->throttle) != 0) {
+        fprintf(stderr, "[SentinelFS] Failed to allocate the process score table\n");
+        exit(1);
+    }
+    rename_watch_init(global_ctx->rename_threshold);
+
+    if (write_stage_init(global_ctx->write_window, write_checked) != 0) {
+        fprintf(stderr, "[SentinelFS] Failed to allocate the write staging table\n");
         exit(1);
     }
 
     mkdir(global_ctx->backup_path, 0700);  // Create backup dir
+    int canaries = canary_init(global_ctx->storage_path, global_ctx->canaries, global_ctx->canary_seed);
+    if (canaries > 0) {
+        fprintf(stderr, "[SentinelFS] %d canary files armed\n", canaries);
+    }
+    if (quarantine_init(global_ctx->quarantine ? global_ctx->backup_path : NULL, quarantine_judge) != 0) {
+        fprintf(stderr, "[SentinelFS] Failed to allocate the quarantine table\n");
+        exit(1);
+    }
+    backup_io_init(global_ctx->backup_rate_mb, global_ctx->backup_ioprio, global_ctx->backup_cache);
+    if (backup_init(global_ctx->backup_path, global_ctx->backup_method,
+                    global_ctx->backup_window, BACKUP_MAX_FILES,
+                    global_ctx->backup_compress) != 0) {
+        fprintf(stderr, "[SentinelFS] Failed to start backup workers\n");
+        exit(1);
+    }
+
+    backup_gc_policy_t policy = {
+        .max_bytes = (unsigned long long)global_ctx->backup_max_mb * 1024 * 1024,
+        .uid_quota = (unsigned long long)global_ctx->backup_uid_quota_mb * 1024 * 1024,
+        .max_age = global_ctx->backup_max_age,
+        .max_versions = global_ctx->backup_max_versions,
+        .min_age = global_ctx->backup_window,
+        .rate = global_ctx->backup_gc_rate,
+    };
+    if (backup_gc_start(global_ctx->backup_path, &policy) != 0) {
+        fprintf(stderr, "[SentinelFS] Failed to start backup GC\n");
+        exit(1);
+    }
 
     return global_ctx;
 }
@@ -443,15 +1027,16 @@ static void *sentinelfs_init(struct fuse_conn_info *conn, struct fuse_config *cf
 static void sentinelfs_destroy(void *private_data) {
     (void) private_data;
 
+    write_stage_destroy();  // Land staged runs while detection and backups still run
+    quarantine_destroy();   // Then commit or discard what is quarantined
+    backup_gc_stop();
+    backup_shutdown();  // Let queued backups finish
+
     fprintf(stderr, "\n[SentinelFS] Shutdown Statistics:\n");
-    fprintf(stderr, "  Total writes: %lu\n", stats.total_writes);
-    fprintf(stderr, "  Blocked writes: %lu (%.2f%%)\n", stats.blocked_writes,
-            stats.total_writes > 0 ? (100.0 * stats.blocked_writes / stats.total_writes) : 0.0);
-    fprintf(stderr, "  Backups created: %lu\n", stats.backups_created);
+    print_stats(stderr);
 
-    if (global_ctx->magic_cookie) {
-        magic_close(global_ctx->magic_cookie);
-    }
+    pid_score_destroy();
+    pipeline_destroy();
 }
 
 // FUSE operations table
@@ -463,6 +1048,9 @@ static struct fuse_operations sentinelfs_oper = {
     .open       = sentinelfs_open,
     .read       = sentinelfs_read,
     .write      = sentinelfs_write,
+    .flush      = sentinelfs_flush,
+    .release    = sentinelfs_release,
+    .fsync      = sentinelfs_fsync,
     .create     = sentinelfs_create,
     .mkdir      = sentinelfs_mkdir,
     .unlink     = sentinelfs_unlink,
@@ -476,8 +1064,37 @@ static struct fuse_operations sentinelfs_oper = {
 // Main
 int main(int argc, char *argv[]) {
     if (argc < 3) {
-        fprintf(stderr, "Usage: %s <storage_path> <mount_point>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <storage_path> <mount_point> [FUSE options]\n", argv[0]);
         fprintf(stderr, "Example: %s /tmp/storage /tmp/mount\n", argv[0]);
+        fprintf(stderr, "\nSentinelFS options:\n");
+        fprintf(stderr, "  -o no_magic    Disable LibMagic fallback (structural validators only)\n");
+        fprintf(stderr, "  -o no_baseline  Only the fixed entropy threshold, no per-type/per-directory baselines\n");
+        fprintf(stderr, "  -o canaries=a:b  Decoy files (paths inside the mount): touching one flags the process\n");
+        fprintf(stderr, "  -o canary_seed  Create decoy files in the root and every top-level directory\n");
+        fprintf(stderr, "  -o pipeline=a:b:...  Detection stage order (default: %s)\n",
+                DEFAULT_PIPELINE);
+        fprintf(stderr, "  -o detector_dir=DIR  Load detector modules (*.so) from DIR\n");
+        fprintf(stderr, "  -o backup_method=auto|reflink|copy_file_range|sendfile\n");
+        fprintf(stderr, "  -o backup_window=SECS  Back each file up at most once per window (default: %d)\n",
+                BACKUP_WINDOW_DEFAULT);
+        fprintf(stderr, "  -o backup_compress  Compress backups in the background (zlib)\n");
+        fprintf(stderr, "  -o backup_max_mb=N,backup_max_age=SECS,backup_max_versions=N,backup_uid_quota_mb=N\n");
+        fprintf(stderr, "                 Backup retention (default: max age %d days)\n",
+                BACKUP_GC_MAX_AGE_DEFAULT / 86400);
+        fprintf(stderr, "  -o backup_gc_rate=OPS  Backup GC I/O operations per second (default: %d)\n",
+                BACKUP_GC_RATE_DEFAULT);
+        fprintf(stderr, "  -o backup_rate_mb=N  Cap background backup I/O at N MB/s (default: unlimited)\n");
+        fprintf(stderr, "  -o backup_ioprio=none|be|idle  I/O class of backup threads (default: be)\n");
+        fprintf(stderr, "  -o backup_cache=keep|drop|direct  Page cache use of backup files (default: drop)\n");
+        fprintf(stderr, "  -o pid_threshold=PCT  Block processes whose behavior scores PCT (default: %d, 0 = off)\n",
+                PID_SCORE_THRESHOLD_DEFAULT);
+        fprintf(stderr, "  -o throttle=PCT  Slow the writes of processes scoring PCT, more as they near the threshold (default: %d, 0 = off)\n",
+                PID_THROTTLE_START_DEFAULT);
+        fprintf(stderr, "  -o rename_threshold=N  Refuse renames once N go to one new extension within %ds (default: %d, 0 = off)\n",
+                RENAME_WATCH_WINDOW, RENAME_WATCH_THRESHOLD_DEFAULT);
+        fprintf(stderr, "  -o quarantine  Keep blocked writes in a shadow file until release instead of failing them\n");
+        fprintf(stderr, "  -o write_window=KB  Inspect small writes to a file in runs of up to KB (default: %d, max %d, 0 = off)\n",
+                WRITE_STAGE_WINDOW_DEFAULT, WRITE_STAGE_WINDOW_MAX);
         return 1;
     }
 
@@ -507,7 +1124,8 @@ int main(int argc, char *argv[]) {
     printf("Mount point:       %s\n", argv[2]);
     printf("Backup directory:  %s\n", global_ctx->backup_path);
     printf("Entropy threshold: %.1f\n", ENTROPY_THRESHOLD);
-    printf("Backup size limit: %dMB\n\n", (int)(JIT_BACKUP_MAX_SIZE / 1024 / 1024));
+    printf("Backup size limit: %dMB (larger files: pre-image journal)\n",
+           (int)(JIT_BACKUP_MAX_SIZE / 1024 / 1024));
 
     // Prepare FUSE arguments
     int fuse_argc = argc - 1;
@@ -518,11 +1136,88 @@ int main(int argc, char *argv[]) {
     }
     fuse_argv[fuse_argc] = NULL;
 
+    // Pull out our own -o options, leave the rest for FUSE
+    global_ctx->backup_window = BACKUP_WINDOW_DEFAULT;
+    global_ctx->backup_max_age = BACKUP_GC_MAX_AGE_DEFAULT;
+    global_ctx->backup_gc_rate = BACKUP_GC_RATE_DEFAULT;
+    global_ctx->backup_ioprio = BACKUP_IOPRIO_BE;
+    global_ctx->backup_cache = BACKUP_CACHE_DROP;
+    global_ctx->pid_threshold = PID_SCORE_THRESHOLD_DEFAULT;
+    global_ctx->throttle = PID_THROTTLE_START_DEFAULT;
+    global_ctx->write_window = WRITE_STAGE_WINDOW_DEFAULT;
+    global_ctx->rename_threshold = RENAME_WATCH_THRESHOLD_DEFAULT;
+    struct fuse_args args = FUSE_ARGS_INIT(fuse_argc, fuse_argv);
+    if (fuse_opt_parse(&args, global_ctx, sentinelfs_opts, NULL) == -1) {
+        return 1;
+    }
+    // Quarantine tells a blocked writer it succeeded, so only the process
+    // flag stops an attack from moving on through every file
+    if (global_ctx->quarantine && !global_ctx->pid_threshold) {
+        fprintf(stderr, "-o quarantine needs process scoring, drop pid_threshold=0\n");
+        return 1;
+    }
+    if (global_ctx->write_window > WRITE_STAGE_WINDOW_MAX) {
+        global_ctx->write_window = WRITE_STAGE_WINDOW_MAX;
+    }
+
+    for (size_t i = 0; i < sizeof(builtin_detectors) / sizeof(builtin_detectors[0]); i++) {
+        pipeline_register(&builtin_detectors[i]);
+    }
+    if (global_ctx->detector_dir && pipeline_load_dir(global_ctx->detector_dir) < 0) {
+        return 1;
+    }
+    // Loaded modules run after the built-in stages unless placed explicitly
+    if (pipeline_configure(global_ctx->pipeline ? global_ctx->pipeline : DEFAULT_PIPELINE,
+                           !global_ctx->pipeline) != 0) {
+        return 1;
+    }
+    if (global_ctx->no_magic) {
+        pipeline_remove("magic");
+    }
+
+    printf("LibMagic fallback: %s\n", pipeline_has_stage("magic") ? "enabled" : "disabled");
+    printf("Entropy baselines: %s\n", global_ctx->no_baseline ? "off" : "per type and directory");
+    printf("Canaries:          %s%s\n", global_ctx->canary_seed ? "seeded " : "",
+           global_ctx->canaries ? global_ctx->canaries : global_ctx->canary_seed ? "" : "none");
+    printf("Backup method:     %s\n", backup_method_names[global_ctx->backup_method]);
+    printf("Backup window:     %us\n", global_ctx->backup_window);
+    printf("Backup compress:   %s\n", global_ctx->backup_compress ? "zlib" : "off");
+    printf("Backup retention:  max age %us, max versions %u, max %uMB, uid quota %uMB (0 = none)\n",
+           global_ctx->backup_max_age, global_ctx->backup_max_versions,
+           global_ctx->backup_max_mb, global_ctx->backup_uid_quota_mb);
+    printf("Backup I/O:        ioprio %s, cache %s, rate %uMB/s (0 = unlimited)\n",
+           backup_ioprio_names[global_ctx->backup_ioprio], backup_cache_names[global_ctx->backup_cache],
+           global_ctx->backup_rate_mb);
+    if (global_ctx->pid_threshold) {
+        printf("Process scoring:   flag at %u%%", global_ctx->pid_threshold);
+        if (global_ctx->throttle && global_ctx->throttle < global_ctx->pid_threshold) {
+            printf(", throttle writes from %u%%", global_ctx->throttle);
+        }
+        printf("\n");
+    } else {
+        printf("Process scoring:   off\n");
+    }
+    if (global_ctx->rename_threshold) {
+        printf("Rename watch:      %u renames to one extension in %ds\n", global_ctx->rename_threshold,
+               RENAME_WATCH_WINDOW);
+    } else {
+        printf("Rename watch:      off\n");
+    }
+    printf("Blocked writes:    %s\n", global_ctx->quarantine ? "quarantined until release" : "fail with EIO");
+    printf("Write window:      %uKB (0 = off)\n", global_ctx->write_window);
+    printf("Pipeline:          ");
+    pipeline_print_order(stdout);
+    printf("\n");
+
     // Run FUSE
-    int ret = fuse_main(fuse_argc, fuse_argv, &sentinelfs_oper, NULL);
+    int ret = fuse_main(args.argc, args.argv, &sentinelfs_oper, NULL);
 
     // Cleanup
+    fuse_opt_free_args(&args);
     free(fuse_argv);
+    free(global_ctx->pipeline);
+    free(global_ctx->detector_dir);
+    free(global_ctx->canaries);
     free(global_ctx->backup_path);
     free(global_ctx->storage_path);
     free(global_ctx);
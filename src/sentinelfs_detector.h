@@ -0,0 +1,71 @@
+/*
+ * SentinelFS - Detector module ABI
+ *
+ * Every stage of the detection pipeline is a detector: the built-in ones
+ * are compiled in, others are shared objects loaded with dlopen() from the
+ * directory given by -o detector_dir=. A module exports one function,
+ *
+ *     const sentinelfs_detector_t *sentinelfs_detector(void);
+ *
+ * and is compiled against this header only, with 64-bit file offsets like
+ * the daemon (off_t and struct stat are part of the ABI):
+ *
+ *     gcc -shared -fPIC -D_FILE_OFFSET_BITS=64 -o my_detector.so my_detector.c
+ *
+ * inspect() is called concurrently from FUSE worker threads, so any state
+ * it touches must be thread-safe.
+ */
+
+#ifndef SENTINELFS_DETECTOR_H
+#define SENTINELFS_DETECTOR_H
+
+#include <stddef.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define SENTINELFS_DETECTOR_ABI 1
+#define SENTINELFS_DETECTOR_SYMBOL "sentinelfs_detector"
+
+// On 32-bit targets a module built without the flag disagrees with the
+// daemon about the layout of sentinelfs_write_t and struct stat
+_Static_assert(sizeof(off_t) == 8, "build with -D_FILE_OFFSET_BITS=64");
+
+typedef enum {
+    DETECTOR_CONTINUE = 0,  // No opinion, next stage decides
+    DETECTOR_SUSPECT,       // Flag the write; blocked at the end unless a later stage allows it
+    DETECTOR_ALLOW,         // Stop here, let the write through
+    DETECTOR_BLOCK          // Stop here, fail the write with -EIO
+} detector_verdict_t;
+
+// Findings shared between the stages that judge one write
+#define DETECTOR_FLAG_STRUCTURE_BROKEN 0x1  // Known signature with broken structure
+
+// One write, as seen by a detector
+typedef struct {
+    const unsigned char *buffer;
+    size_t len;
+    off_t offset;
+    const char *path;       // Path inside the mount
+    const struct stat *st;  // Target file, before the write
+    pid_t pid;              // Writing process
+    unsigned flags;         // DETECTOR_FLAG_*, may be set by any stage
+    double entropy;         // Shannon entropy of buffer, -1 until a stage computes it
+} sentinelfs_write_t;
+
+typedef struct {
+    unsigned abi_version;   // SENTINELFS_DETECTOR_ABI
+    const char *name;       // Stage name used in -o pipeline=
+    int stateful;           // Keeps per-file state: also sees writes an earlier stage allowed
+
+    // Optional. Returns 0 on success; *state is handed to inspect and destroy.
+    int (*init)(void **state);
+    // Returns the verdict; *confidence (0.0-1.0, preset to 1.0) says how sure
+    // the detector is. SUSPECT verdicts below 0.5 do not block on their own.
+    detector_verdict_t (*inspect)(void *state, sentinelfs_write_t *write, double *confidence);
+    // Optional. Called once at unmount.
+    void (*destroy)(void *state);
+} sentinelfs_detector_t;
+
+typedef const sentinelfs_detector_t *(*sentinelfs_detector_fn)(void);
+
+#endif /* SENTINELFS_DETECTOR_H */
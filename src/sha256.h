@@ -0,0 +1,30 @@
+/*
+ * SentinelFS - SHA-256 (FIPS 180-4)
+ *
+ * Names chunks in the content-addressed backup store. A cryptographic hash
+ * is needed there: with a weaker one, a process could plant a colliding
+ * chunk and corrupt other files' backups.
+ */
+
+#ifndef SENTINELFS_SHA256_H
+#define SENTINELFS_SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_DIGEST_SIZE 32
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t bytes;
+    unsigned char block[64];
+    size_t used;
+} sha256_ctx_t;
+
+void sha256_init(sha256_ctx_t *ctx);
+void sha256_update(sha256_ctx_t *ctx, const void *data, size_t len);
+void sha256_final(sha256_ctx_t *ctx, unsigned char digest[SHA256_DIGEST_SIZE]);
+
+void sha256(const void *data, size_t len, unsigned char digest[SHA256_DIGEST_SIZE]);
+
+#endif /* SENTINELFS_SHA256_H */
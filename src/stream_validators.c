@@ -0,0 +1,596 @@
+/*
+ * SentinelFS - Streaming container validators
+ *
+ * Each tracked file has a small parser state: the file offset where the
+ * next record header is due, a carry buffer for headers split across two
+ * writes, and a high-water mark of what has been written. Writes that land
+ * inside a declared payload are accepted without looking at them, so the
+ * cost is proportional to header bytes, not payload bytes. Two formats
+ * need a light scan of the payload because their records are not length
+ * prefixed: JPEG entropy-coded segments (memchr for 0xFF) and streamed ZIP
+ * members (memchr for the data descriptor signature). Stored and encrypted
+ * ZIP members, and deflate members that start with a stored block, are
+ * skipped the same way but not vouched for: writes that carry their data
+ * are STREAM_UNKNOWN, so entropy still judges them. So is payload that no
+ * header bounds (an MP4 mdat running to end of file, a gzip body past the
+ * bytes we inflated): only the header bytes of such a file are vouched for.
+ */
+
+#include "stream_validators.h"
+#include "inode_table.h"
+#include "validators.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define STREAM_CARRY_MAX  128  // Largest header we reassemble across writes
+#define STREAM_PATCH_MAX  64   // Rewrites of already-written bytes up to this size are header patches
+#define GZIP_NAME_MAX     1024 // FNAME/FCOMMENT length limit
+
+enum { FMT_NONE = 0, FMT_PNG, FMT_JPEG, FMT_MP4, FMT_ZIP, FMT_GZIP };
+
+static const char *format_names[] = { NULL, "png", "jpeg", "mp4", "zip", "gzip" };
+
+enum {
+    MODE_HEADER = 0,  // Next record header due at 'next'
+    MODE_SCAN,        // Scanning payload for the next record, scanned up to 'next'
+    MODE_TAIL,        // Unbounded payload past 'next', never vouched for
+    MODE_DONE,        // End record seen at 'next'
+    MODE_LOST,        // Non-sequential write skipped a header, stop judging
+    MODE_BAD          // Structure violated
+};
+
+#define FLAG_JPEG_FF     0x01  // JPEG scan: previous write ended on 0xFF
+#define FLAG_ZIP_DESC    0x02  // ZIP: data descriptor due at 'next'
+#define FLAG_ZIP_STREAM  0x04  // ZIP: current member has unknown size (data_start valid)
+#define FLAG_ZIP64       0x08  // ZIP: current member uses 8-byte descriptor sizes
+
+typedef struct {
+    uint8_t format;
+    uint8_t mode;
+    uint8_t flags;
+    uint8_t carry_len;
+    uint32_t records;
+    uint32_t window;      // ZIP scan: last four bytes seen, for split signatures
+    uint64_t next;
+    uint64_t written;     // High-water mark of bytes written
+    uint64_t data_start;  // ZIP scan: file offset of the streamed member's data
+    uint64_t opaque_from; // ZIP: latest member data we cannot vouch for
+    uint64_t opaque_to;   // (stored/encrypted), UINT64_MAX while streamed
+    unsigned char carry[STREAM_CARRY_MAX];
+} stream_state_t;
+
+typedef struct {
+    const unsigned char *buf;
+    size_t len;
+    uint64_t off;
+} write_view_t;
+
+enum { STEP_NEXT, STEP_MORE, STEP_BAD, STEP_LOST };
+
+static inode_table_t *stream_table = NULL;
+
+static uint16_t be16(const unsigned char *p) { return (uint16_t)(p[0] << 8 | p[1]); }
+static uint32_t be32(const unsigned char *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+static uint64_t be64(const unsigned char *p) { return (uint64_t)be32(p) << 32 | be32(p + 4); }
+static uint16_t le16(const unsigned char *p) { return (uint16_t)(p[1] << 8 | p[0]); }
+static uint32_t le32(const unsigned char *p) {
+    return (uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | p[0];
+}
+static uint64_t le64(const unsigned char *p) { return (uint64_t)le32(p + 4) << 32 | le32(p); }
+
+// Bytes of the header at s->next, either straight from this write or
+// reassembled in the carry buffer. Returns NULL with *step set when the
+// header continues in a later write (or is too big to carry).
+static const unsigned char *gather(stream_state_t *s, const write_view_t *w,
+                                   size_t need, int *step) {
+    uint64_t end = w->off + w->len;
+
+    if (s->carry_len == 0 && end - s->next >= need) {
+        return w->buf + (s->next - w->off);
+    }
+    if (need > STREAM_CARRY_MAX) {
+        *step = STEP_LOST;
+        return NULL;
+    }
+
+    size_t from = (size_t)(s->next + s->carry_len - w->off);
+    size_t take = need > s->carry_len ? need - s->carry_len : 0;
+    if (take > w->len - from) take = w->len - from;
+
+    memcpy(s->carry + s->carry_len, w->buf + from, take);
+    s->carry_len += (uint8_t)take;
+    if (s->carry_len >= need) return s->carry;
+
+    *step = STEP_MORE;
+    return NULL;
+}
+
+// Move past a record of the given size
+static void consume(stream_state_t *s, uint64_t size) {
+    s->next += size;
+    if (s->carry_len > size) {
+        memmove(s->carry, s->carry + size, s->carry_len - size);
+        s->carry_len -= (uint8_t)size;
+    } else {
+        s->carry_len = 0;
+    }
+}
+
+/* ----------------------------------------------------------------- PNG */
+
+static int png_type_ok(const unsigned char *t) {
+    for (int i = 0; i < 4; i++) {
+        unsigned char c = t[i] | 0x20;
+        if (c < 'a' || c > 'z') return 0;
+    }
+    return !(t[2] & 0x20);  // Reserved bit must be clear
+}
+
+static int step_png(stream_state_t *s, const write_view_t *w) {
+    int step = STEP_MORE;
+    const unsigned char *h = gather(s, w, 8, &step);
+    if (!h) return step;
+
+    uint32_t n = be32(h);
+    if (n > 0x7fffffffu || !png_type_ok(h + 4)) return STEP_BAD;
+    if (s->records++ == 0 && (memcmp(h + 4, "IHDR", 4) != 0 || n != 13)) return STEP_BAD;
+
+    if (memcmp(h + 4, "IEND", 4) == 0) {
+        if (n != 0) return STEP_BAD;
+        consume(s, 12);
+        s->mode = MODE_DONE;
+        return STEP_NEXT;
+    }
+
+    consume(s, 12 + (uint64_t)n);  // Length, type, data, CRC
+    return STEP_NEXT;
+}
+
+/* ---------------------------------------------------------------- JPEG */
+
+static int step_jpeg(stream_state_t *s, const write_view_t *w) {
+    int step = STEP_MORE;
+    const unsigned char *h = gather(s, w, 2, &step);
+    if (!h) return step;
+    if (h[0] != 0xff) return STEP_BAD;
+
+    unsigned char m = h[1];
+    if (m == 0xff) {
+        consume(s, 1);  // Fill byte
+        return STEP_NEXT;
+    }
+    if (m == 0xd8) {
+        if (s->records++ != 0) return STEP_BAD;
+        consume(s, 2);
+        return STEP_NEXT;
+    }
+    if (m == 0xd9) {
+        consume(s, 2);
+        s->mode = MODE_DONE;
+        return STEP_NEXT;
+    }
+    if ((m >= 0xd0 && m <= 0xd7) || m == 0x01) {
+        consume(s, 2);  // Standalone markers
+        return STEP_NEXT;
+    }
+    if (m < 0xc0) return STEP_BAD;
+
+    h = gather(s, w, 4, &step);
+    if (!h) return step;
+    uint16_t seglen = be16(h + 2);
+    if (seglen < 2) return STEP_BAD;
+
+    s->records++;
+    consume(s, 2 + (uint64_t)seglen);
+    if (m == 0xda) {
+        s->mode = MODE_SCAN;  // Entropy-coded data follows the scan header
+        s->flags &= ~FLAG_JPEG_FF;
+    }
+    return STEP_NEXT;
+}
+
+// Entropy-coded segment: 0xFF must be stuffed (FF 00) or a restart marker;
+// anything else ends the segment and is parsed as a marker
+static int scan_jpeg(stream_state_t *s, const write_view_t *w) {
+    size_t i = (size_t)(s->next - w->off);
+
+    if (s->flags & FLAG_JPEG_FF) {
+        unsigned char c = w->buf[i];
+        s->flags &= ~FLAG_JPEG_FF;
+        if (c != 0x00 && !(c >= 0xd0 && c <= 0xd7)) {
+            s->next -= 1;
+            s->carry[0] = 0xff;
+            s->carry_len = 1;
+            s->mode = MODE_HEADER;
+            return STEP_NEXT;
+        }
+        i++;
+    }
+
+    while (i < w->len) {
+        const unsigned char *p = memchr(w->buf + i, 0xff, w->len - i);
+        if (!p) break;
+
+        size_t j = (size_t)(p - w->buf);
+        if (j + 1 >= w->len) {
+            s->flags |= FLAG_JPEG_FF;
+            break;
+        }
+
+        unsigned char c = w->buf[j + 1];
+        if (c == 0x00 || (c >= 0xd0 && c <= 0xd7)) {
+            i = j + 2;
+            continue;
+        }
+
+        s->next = w->off + j;
+        s->mode = MODE_HEADER;
+        return STEP_NEXT;
+    }
+
+    s->next = w->off + w->len;
+    return STEP_MORE;
+}
+
+/* ----------------------------------------------------------------- MP4 */
+
+static int box_type_ok(const unsigned char *t) {
+    for (int i = 0; i < 4; i++) {
+        if ((t[i] < 0x20 || t[i] > 0x7e) && t[i] != 0xa9) return 0;  // 0xa9 = '©' in iTunes atoms
+    }
+    return 1;
+}
+
+static int step_mp4(stream_state_t *s, const write_view_t *w) {
+    int step = STEP_MORE;
+    const unsigned char *h = gather(s, w, 8, &step);
+    if (!h) return step;
+
+    uint64_t size = be32(h);
+    if (!box_type_ok(h + 4)) return STEP_BAD;
+    if (s->records++ == 0 && memcmp(h + 4, "ftyp", 4) != 0) return STEP_BAD;
+
+    if (size == 0) {
+        // Box runs to end of file: only media data may (ftyp never)
+        if (memcmp(h + 4, "mdat", 4) != 0) return STEP_BAD;
+        consume(s, 8);
+        s->mode = MODE_TAIL;
+        return STEP_NEXT;
+    }
+    if (size == 1) {
+        h = gather(s, w, 16, &step);
+        if (!h) return step;
+        size = be64(h + 8);
+        if (size < 16) return STEP_BAD;
+    } else if (size < 8) {
+        return STEP_BAD;
+    }
+
+    consume(s, size);
+    return STEP_NEXT;
+}
+
+/* ----------------------------------------------------------------- ZIP */
+
+static int step_zip_descriptor(stream_state_t *s, const write_view_t *w) {
+    int step = STEP_MORE;
+    const unsigned char *h = gather(s, w, 4, &step);
+    if (!h) return step;
+
+    size_t size = (s->flags & FLAG_ZIP64) ? 20 : 12;
+    if (le32(h) == ZIP_SIG_DESCRIPTOR) {
+        size += 4;
+    } else if (s->flags & FLAG_ZIP_STREAM) {
+        return STEP_BAD;  // We only stop scanning on the signature
+    }
+
+    if (s->flags & FLAG_ZIP_STREAM) {
+        h = gather(s, w, size, &step);
+        if (!h) return step;
+
+        // Compressed size must match what was actually written; a mismatch
+        // means the signature was a coincidence inside member data
+        uint64_t written = s->next - s->data_start;
+        uint64_t csize = (s->flags & FLAG_ZIP64) ? le64(h + 8) : le32(h + 8);
+        if (csize != ((s->flags & FLAG_ZIP64) ? written : (uint32_t)written)) return STEP_LOST;
+    }
+
+    if (s->opaque_to == UINT64_MAX) s->opaque_to = s->next;  // Streamed member ends here
+    s->flags &= ~(FLAG_ZIP_DESC | FLAG_ZIP_STREAM | FLAG_ZIP64);
+    consume(s, size);
+    return STEP_NEXT;
+}
+
+static int step_zip(stream_state_t *s, const write_view_t *w) {
+    if (s->flags & FLAG_ZIP_DESC) return step_zip_descriptor(s, w);
+
+    int step = STEP_MORE;
+    const unsigned char *h = gather(s, w, 4, &step);
+    if (!h) return step;
+
+    uint32_t sig = le32(h);
+    zip_record_t rec;
+
+    if (sig == ZIP_SIG_LOCAL) {
+        if (!(h = gather(s, w, 30, &step))) return step;
+        size_t need = 30 + (size_t)le16(h + 26) + le16(h + 28);
+        if (!(h = gather(s, w, need, &step))) return step;
+        if (zip_local_record(h, need, &rec) != VALIDATE_OK) return STEP_BAD;
+        s->records++;
+
+        // Inflate the start of deflate data when it is part of this write
+        uint64_t data = s->next + rec.header_len;
+        uint64_t end = w->off + w->len;
+        validate_result_t d = VALIDATE_OK;
+        if (data >= w->off && data < end) {
+            d = zip_member_data(&rec, w->buf + (data - w->off), (size_t)(end - data));
+            if (d == VALIDATE_BAD) return STEP_BAD;
+        }
+
+        // Stored, encrypted or raw-block data is skipped but not vouched for
+        if (d == VALIDATE_UNKNOWN || rec.method != ZIP_METHOD_DEFLATE || (rec.flags & ZIP_FLAG_ENCRYPTED)) {
+            int streamed = (rec.flags & ZIP_FLAG_DESCRIPTOR) && rec.csize == 0;
+            s->opaque_from = data;
+            s->opaque_to = streamed ? UINT64_MAX : data + rec.csize;
+        }
+
+        if (rec.flags & ZIP_FLAG_DESCRIPTOR) {
+            s->flags |= FLAG_ZIP_DESC;
+            if (rec.csize >= 0xffffffffu) s->flags |= FLAG_ZIP64;
+        }
+        if ((rec.flags & ZIP_FLAG_DESCRIPTOR) && rec.csize == 0) {
+            consume(s, rec.header_len);
+            s->flags |= FLAG_ZIP_STREAM;
+            s->data_start = s->next;
+            s->window = 0;
+            s->mode = MODE_SCAN;
+            return STEP_NEXT;
+        }
+        consume(s, rec.header_len + rec.csize);
+        return STEP_NEXT;
+    }
+
+    if (sig == ZIP_SIG_CENTRAL) {
+        if (!(h = gather(s, w, 46, &step))) return step;
+        size_t need = 46 + (size_t)le16(h + 28);
+        if (!(h = gather(s, w, need, &step))) return step;
+        if (zip_central_record(h, need, &rec) != VALIDATE_OK) return STEP_BAD;
+        s->records++;
+        consume(s, rec.header_len);
+        return STEP_NEXT;
+    }
+
+    if (sig == ZIP_SIG_EOCD) {
+        if (!(h = gather(s, w, 22, &step))) return step;
+        if (le16(h + 8) > le16(h + 10)) return STEP_BAD;
+        consume(s, 22 + (uint64_t)le16(h + 20));
+        s->mode = MODE_DONE;
+        return STEP_NEXT;
+    }
+
+    if (sig == ZIP_SIG_EOCD64) {
+        if (!(h = gather(s, w, 12, &step))) return step;
+        consume(s, 12 + le64(h + 4));
+        return STEP_NEXT;
+    }
+
+    if (sig == ZIP_SIG_LOCATOR64) {
+        consume(s, 20);
+        return STEP_NEXT;
+    }
+
+    if (sig == ZIP_SIG_DIGSIG) {
+        if (!(h = gather(s, w, 6, &step))) return step;
+        consume(s, 6 + (uint64_t)le16(h + 4));
+        return STEP_NEXT;
+    }
+
+    return STEP_BAD;
+}
+
+// Streamed member: look for the data descriptor signature "PK\7\8"
+static int scan_zip(stream_state_t *s, const write_view_t *w) {
+    size_t i = (size_t)(s->next - w->off);
+    uint64_t found = 0;
+
+    // Signature split across the previous write and this one
+    for (size_t k = 0; k < 3 && i + k < w->len; k++) {
+        s->window = s->window >> 8 | (uint32_t)w->buf[i + k] << 24;
+        if (s->window == ZIP_SIG_DESCRIPTOR && w->off + i + k >= s->data_start + 3) {
+            found = w->off + i + k - 3;
+            break;
+        }
+    }
+
+    for (size_t j = i; !found && j + 4 <= w->len; j++) {
+        const unsigned char *p = memchr(w->buf + j, 'P', w->len - j - 3);
+        if (!p) break;
+        j = (size_t)(p - w->buf);
+        if (le32(p) == ZIP_SIG_DESCRIPTOR) found = w->off + j;
+    }
+
+    if (found) {
+        // Hand the descriptor to the header parser; bytes of the signature
+        // that arrived with the previous write go into the carry buffer
+        s->next = found;
+        s->carry_len = 0;
+        if (found < w->off) {
+            static const unsigned char sig[4] = { 'P', 'K', 7, 8 };
+            s->carry_len = (uint8_t)(w->off - found);
+            memcpy(s->carry, sig, s->carry_len);
+        }
+        s->mode = MODE_HEADER;
+        return STEP_NEXT;
+    }
+
+    if (w->len - i > 3) s->window = le32(w->buf + w->len - 4);
+    s->next = w->off + w->len;
+    return STEP_MORE;
+}
+
+/* ---------------------------------------------------------------- gzip */
+
+// Length of the gzip member header, 0 if it doesn't fit, -1 if malformed
+static long gzip_header(const unsigned char *buf, size_t len) {
+    if (len < 10) return 0;
+
+    unsigned char flg = buf[3], xfl = buf[8], os = buf[9];
+    if (buf[2] != 8 || (flg & 0xe0)) return -1;  // Deflate only, reserved flags clear
+    if (xfl != 0 && xfl != 2 && xfl != 4) return -1;
+    if (os > 13 && os != 255) return -1;
+
+    size_t p = 10;
+    if (flg & 0x04) {  // FEXTRA
+        if (p + 2 > len) return 0;
+        p += 2 + (size_t)le16(buf + p);
+    }
+    for (unsigned char bit = 0x08; bit <= 0x10; bit <<= 1) {  // FNAME, FCOMMENT
+        if (!(flg & bit)) continue;
+        size_t limit = len - p < GZIP_NAME_MAX ? len - p : GZIP_NAME_MAX;
+        if (p >= len) return 0;
+        const unsigned char *nul = memchr(buf + p, 0, limit);
+        if (!nul) return limit == GZIP_NAME_MAX ? -1 : 0;
+        for (const unsigned char *c = buf + p; c < nul; c++) {
+            if (*c < 0x20 && *c != '\n' && *c != '\t') return -1;
+        }
+        p = (size_t)(nul - buf) + 1;
+    }
+    if (flg & 0x02) p += 2;  // FHCRC
+
+    return p <= len ? (long)p : 0;
+}
+
+/* ---------------------------------------------------------------- core */
+
+static int sniff(const unsigned char *buf, size_t len) {
+    static const unsigned char png_sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+    if (len >= 8 && memcmp(buf, png_sig, 8) == 0) return FMT_PNG;
+    if (len >= 3 && buf[0] == 0xff && buf[1] == 0xd8 && buf[2] == 0xff) return FMT_JPEG;
+    if (len >= 8 && memcmp(buf + 4, "ftyp", 4) == 0) return FMT_MP4;
+    if (len >= 4 && le32(buf) == ZIP_SIG_LOCAL) return FMT_ZIP;
+    if (len >= 3 && buf[0] == 0x1f && buf[1] == 0x8b) return FMT_GZIP;
+    return FMT_NONE;
+}
+
+static void begin(stream_state_t *s, int format, const unsigned char *buf, size_t len) {
+    memset(s, 0, sizeof(*s));
+    s->format = (uint8_t)format;
+
+    switch (format) {
+    case FMT_PNG:
+        s->next = 8;  // Signature
+        break;
+    case FMT_GZIP: {
+        // Member boundaries are invisible without inflating, so check the
+        // header and the deflate bytes of this write; the rest is payload
+        long hdr = gzip_header(buf, len);
+        int complete = 0;
+        long checked = hdr > 0 ? deflate_probe(buf + hdr, len - (size_t)hdr, &complete) : 0;
+        if (hdr < 0 || checked < 0) {
+            s->mode = MODE_BAD;
+        } else {
+            s->mode = hdr > 0 ? MODE_TAIL : MODE_LOST;
+            s->next = (uint64_t)(hdr + checked);
+            if (complete && len - s->next >= 8) s->next += 8;  // CRC32 and ISIZE trailer
+        }
+        break;
+    }
+    default:
+        break;  // First record header at offset 0
+    }
+}
+
+// Does [off, end) cover member data we could not vouch for?
+static int opaque(const stream_state_t *s, uint64_t off, uint64_t end) {
+    return off < s->opaque_to && end > s->opaque_from;
+}
+
+static stream_result_t feed(stream_state_t *s, const unsigned char *buf, size_t len, uint64_t off) {
+    write_view_t w = { buf, len, off };
+    uint64_t end = off + len;
+    uint64_t written = s->written;
+    int unvouched = opaque(s, off, end) || (s->mode == MODE_TAIL && end > s->next);
+
+    if (end > s->written) s->written = end;
+
+    // Rewriting bytes we've already seen: small header patches (sizes, CRCs
+    // filled in after the fact) are fine, anything larger we can't vouch for
+    if (end <= written && s->mode != MODE_BAD) {
+        return len <= STREAM_PATCH_MAX && !unvouched ? STREAM_OK : STREAM_UNKNOWN;
+    }
+
+    for (;;) {
+        if (s->mode == MODE_BAD) return STREAM_VIOLATION;
+        if (s->mode == MODE_LOST) return STREAM_UNKNOWN;
+        // Past the last header we checked, entropy decides
+        if (s->mode == MODE_TAIL || s->mode == MODE_DONE) return end <= s->next ? STREAM_OK : STREAM_UNKNOWN;
+
+        uint64_t frontier = s->next + s->carry_len;
+        if (end <= frontier) return unvouched ? STREAM_UNKNOWN : STREAM_OK;  // Inside a declared payload
+        if (off > frontier) {
+            s->mode = MODE_LOST;  // Skipped over a header we never saw
+            return STREAM_UNKNOWN;
+        }
+
+        int step;
+        if (s->mode == MODE_SCAN) {
+            step = s->format == FMT_JPEG ? scan_jpeg(s, &w) : scan_zip(s, &w);
+        } else {
+            switch (s->format) {
+            case FMT_PNG:  step = step_png(s, &w);  break;
+            case FMT_JPEG: step = step_jpeg(s, &w); break;
+            case FMT_MP4:  step = step_mp4(s, &w);  break;
+            case FMT_ZIP:  step = step_zip(s, &w);  break;
+            default:       step = STEP_LOST;        break;
+            }
+        }
+
+        unvouched |= opaque(s, off, end);
+        if (step == STEP_MORE) return unvouched ? STREAM_UNKNOWN : STREAM_OK;
+        if (step == STEP_BAD) s->mode = MODE_BAD;
+        if (step == STEP_LOST) s->mode = MODE_LOST;
+    }
+}
+
+int stream_validators_init(size_t max_files) {
+    stream_table = inode_table_create(max_files, sizeof(stream_state_t), NULL);
+    return stream_table ? 0 : -1;
+}
+
+void stream_validators_destroy(void) {
+    inode_table_destroy(stream_table);
+    stream_table = NULL;
+}
+
+stream_result_t stream_check(dev_t dev, ino_t ino, const unsigned char *buffer,
+                             size_t len, off_t offset, const char **format) {
+    if (!stream_table || len == 0) return STREAM_UNKNOWN;
+
+    stream_state_t *s;
+    if (offset == 0) {
+        int fmt = sniff(buffer, len);
+        s = inode_table_get(stream_table, dev, ino, fmt != FMT_NONE, NULL);
+
+        if (fmt == FMT_NONE) {
+            if (s) inode_table_remove(stream_table, s);  // Rewritten as something else
+            return STREAM_UNKNOWN;
+        }
+        // A short write at offset 0 into a file we're already following is a
+        // header patch, not a new file
+        if (s->format != fmt || len > STREAM_PATCH_MAX || s->written <= len) {
+            begin(s, fmt, buffer, len);
+        }
+    } else {
+        s = inode_table_get(stream_table, dev, ino, 0, NULL);
+        if (!s) return STREAM_UNKNOWN;
+    }
+
+    stream_result_t res = feed(s, buffer, len, (uint64_t)offset);
+    if (format) *format = format_names[s->format];
+    inode_table_put(stream_table, s);
+    return res;
+}
@@ -0,0 +1,34 @@
+/*
+ * SentinelFS - Streaming container validators
+ *
+ * Compressed media and office formats (PNG, JPEG, MP4, ZIP/DOCX/XLSX, gzip)
+ * are high-entropy by design, so the entropy check blocks them. These
+ * validators follow a file's chunk/box/record structure across successive
+ * writes: only record headers are parsed, payload bytes are skipped using
+ * the sizes the headers declare. Ciphertext written where a header is due
+ * shows up as a structural violation.
+ */
+
+#ifndef SENTINELFS_STREAM_VALIDATORS_H
+#define SENTINELFS_STREAM_VALIDATORS_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef enum {
+    STREAM_UNKNOWN = 0,  // Not a tracked container (or we lost track), caller decides
+    STREAM_OK,           // Write is consistent with the container structure
+    STREAM_VIOLATION     // Write breaks the container structure
+} stream_result_t;
+
+// Per-file parser state lives in a fixed-size table sized at mount time
+int stream_validators_init(size_t max_files);
+void stream_validators_destroy(void);
+
+// Feed one write. A write at offset 0 starts (or restarts) tracking when it
+// carries a known container signature; later writes continue the parse.
+// *format (if not NULL) is set to the container name when one is tracked.
+stream_result_t stream_check(dev_t dev, ino_t ino, const unsigned char *buffer,
+                             size_t len, off_t offset, const char **format);
+
+#endif /* SENTINELFS_STREAM_VALIDATORS_H */
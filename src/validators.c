@@ -0,0 +1,557 @@
+/*
+ * SentinelFS - Structural validators
+ *
+ * Phase III relied on LibMagic to tell a real PDF/ELF/ZIP from ciphertext
+ * with a fake header glued on. LibMagic is generic and expensive; these
+ * parsers know exactly which fields must be consistent for each format and
+ * only ever look at headers, record tables and the trailer window, so the
+ * cost per write is bounded regardless of buffer size.
+ *
+ * Deflate members are additionally fed to a bounded trial inflate: random
+ * bytes behind a forged local header fail it almost immediately. Stored
+ * and encrypted members have nothing to check, so a buffer carrying their
+ * data is left to the entropy and magic stages.
+ *
+ * The one exception is plain text, which has no structure to check: the
+ * text scan walks the buffer but bails out on the first non-text byte, so
+ * ciphertext is rejected within a handful of bytes.
+ */
+
+#include "validators.h"
+
+#include <elf.h>
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+
+#define ELF_MAX_PHDRS       256    // More than this is not a real program header table
+#define PDF_HEAD_WINDOW     1024   // First object must start within this window
+#define PDF_TAIL_WINDOW     1024   // startxref/%%EOF must sit within this window
+#define PDF_XREF_ENTRIES    8      // Cross-reference entries checked per table
+#define ZIP_MAX_RECORDS     64     // Records walked per buffer
+#define ZIP_MAX_NAME        1024   // Longer member names are treated as corrupt
+#define SHEBANG_MAX         256    // Interpreter line length limit
+#define SCRIPT_TEXT_WINDOW  1024   // Bytes after the shebang that must be text
+
+// Little/big-endian field readers (buffer may be unaligned)
+static uint16_t rd16(const unsigned char *p, int be) {
+    return be ? (uint16_t)(p[0] << 8 | p[1]) : (uint16_t)(p[1] << 8 | p[0]);
+}
+
+static uint32_t rd32(const unsigned char *p, int be) {
+    return be ? (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]
+              : (uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | p[0];
+}
+
+static uint64_t rd64(const unsigned char *p, int be) {
+    return be ? (uint64_t)rd32(p, 1) << 32 | rd32(p + 4, 1)
+              : (uint64_t)rd32(p + 4, 0) << 32 | rd32(p, 0);
+}
+
+static const unsigned char *find_bytes(const unsigned char *hay, size_t hay_len,
+                                       const char *needle) {
+    size_t n = strlen(needle);
+    while (hay_len >= n) {
+        const unsigned char *p = memchr(hay, needle[0], hay_len - n + 1);
+        if (!p) return NULL;
+        if (memcmp(p, needle, n) == 0) return p;
+        hay_len -= (size_t)(p - hay) + 1;
+        hay = p + 1;
+    }
+    return NULL;
+}
+
+static int is_pdf_space(unsigned char c) {
+    return c == ' ' || c == '\r' || c == '\n' || c == '\t' || c == '\f' || c == 0;
+}
+
+static int is_digit(unsigned char c) {
+    return c >= '0' && c <= '9';
+}
+
+/* ---------------------------------------------------------------- text */
+
+// Printable ASCII, common whitespace and ESC (ANSI colour codes in logs)
+static int is_text_byte(unsigned char c) {
+    return (c >= 0x20 && c < 0x7f) || c == '\t' || c == '\n' || c == '\r' ||
+           c == '\f' || c == 0x1b;
+}
+
+// Valid UTF-8 text. Partial sequences are tolerated at either edge since a
+// write can split a multi-byte character.
+static int is_text(const unsigned char *buf, size_t len) {
+    size_t i = 0;
+
+    while (i < len && i < 3 && (buf[i] & 0xc0) == 0x80) i++;
+
+    while (i < len) {
+        unsigned char c = buf[i];
+        if (c < 0x80) {
+            if (!is_text_byte(c)) return 0;
+            i++;
+            continue;
+        }
+
+        size_t need;
+        if (c >= 0xc2 && c <= 0xdf) need = 1;
+        else if (c >= 0xe0 && c <= 0xef) need = 2;
+        else if (c >= 0xf0 && c <= 0xf4) need = 3;
+        else return 0;
+
+        if (i + need >= len) return 1;  // Split at the end of the write
+        for (size_t k = 1; k <= need; k++) {
+            if ((buf[i + k] & 0xc0) != 0x80) return 0;
+        }
+        i += need + 1;
+    }
+
+    return 1;
+}
+
+/* ------------------------------------------------------------- shebang */
+
+// "#!/path/to/interp [arg]\n" followed by script text
+static validate_result_t validate_script(const unsigned char *buf, size_t len) {
+    size_t i = 2;
+    while (i < len && (buf[i] == ' ' || buf[i] == '\t')) i++;
+    if (i >= len) return VALIDATE_UNKNOWN;
+    if (buf[i] != '/') return VALIDATE_BAD;
+
+    size_t limit = len < SHEBANG_MAX ? len : SHEBANG_MAX;
+    const unsigned char *nl = memchr(buf, '\n', limit);
+    if (!nl) return len < SHEBANG_MAX ? VALIDATE_UNKNOWN : VALIDATE_BAD;
+
+    size_t line_end = (size_t)(nl - buf);
+    for (size_t k = i; k < line_end; k++) {
+        if (!is_text_byte(buf[k])) return VALIDATE_BAD;
+    }
+
+    size_t body = line_end + 1;
+    size_t window = len - body < SCRIPT_TEXT_WINDOW ? len - body : SCRIPT_TEXT_WINDOW;
+    return is_text(buf + body, window) ? VALIDATE_OK : VALIDATE_BAD;
+}
+
+/* ----------------------------------------------------------------- ELF */
+
+static validate_result_t validate_elf(const unsigned char *buf, size_t len) {
+    if (len < EI_NIDENT) return VALIDATE_UNKNOWN;
+
+    int cls = buf[EI_CLASS];
+    if (cls != ELFCLASS32 && cls != ELFCLASS64) return VALIDATE_BAD;
+    if (buf[EI_DATA] != ELFDATA2LSB && buf[EI_DATA] != ELFDATA2MSB) return VALIDATE_BAD;
+    if (buf[EI_VERSION] != EV_CURRENT) return VALIDATE_BAD;
+    for (int i = EI_PAD; i < EI_NIDENT; i++) {
+        if (buf[i] != 0) return VALIDATE_BAD;
+    }
+
+    int be = buf[EI_DATA] == ELFDATA2MSB;
+    int is64 = cls == ELFCLASS64;
+    size_t ehsize = is64 ? sizeof(Elf64_Ehdr) : sizeof(Elf32_Ehdr);
+    if (len < ehsize) return VALIDATE_UNKNOWN;
+
+    uint16_t type = rd16(buf + 16, be);
+    if (!(type >= ET_REL && type <= ET_CORE) && type < ET_LOOS) return VALIDATE_BAD;
+    if (rd16(buf + 18, be) == EM_NONE) return VALIDATE_BAD;
+    if (rd32(buf + 20, be) != EV_CURRENT) return VALIDATE_BAD;
+
+    uint64_t phoff = is64 ? rd64(buf + 32, be) : rd32(buf + 28, be);
+    const unsigned char *tail = buf + (is64 ? 52 : 40);
+    uint16_t e_ehsize = rd16(tail, be);
+    uint16_t phentsize = rd16(tail + 2, be);
+    uint16_t phnum = rd16(tail + 4, be);
+    uint16_t shentsize = rd16(tail + 6, be);
+    uint16_t shnum = rd16(tail + 8, be);
+    uint16_t shstrndx = rd16(tail + 10, be);
+
+    if (e_ehsize != ehsize) return VALIDATE_BAD;
+    if (shnum > 0 && shentsize != (is64 ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr)))
+        return VALIDATE_BAD;
+    if (shstrndx != SHN_UNDEF && shstrndx != SHN_XINDEX && shstrndx >= shnum)
+        return VALIDATE_BAD;
+
+    if (phnum == 0) {
+        // Relocatable objects have no program headers; executables must
+        return (type == ET_EXEC || type == ET_DYN) ? VALIDATE_BAD : VALIDATE_OK;
+    }
+
+    size_t want_phent = is64 ? sizeof(Elf64_Phdr) : sizeof(Elf32_Phdr);
+    if (phentsize != want_phent || phnum > ELF_MAX_PHDRS) return VALIDATE_BAD;
+    if (phoff < ehsize) return VALIDATE_BAD;
+    if (phoff > len || phoff + (uint64_t)phnum * phentsize > len) return VALIDATE_UNKNOWN;
+
+    int loads = 0;
+    for (uint16_t i = 0; i < phnum; i++) {
+        const unsigned char *ph = buf + phoff + (size_t)i * phentsize;
+        uint32_t p_type = rd32(ph, be);
+        uint32_t p_flags = is64 ? rd32(ph + 4, be) : rd32(ph + 24, be);
+        uint64_t p_offset = is64 ? rd64(ph + 8, be) : rd32(ph + 4, be);
+        uint64_t p_vaddr = is64 ? rd64(ph + 16, be) : rd32(ph + 8, be);
+        uint64_t p_filesz = is64 ? rd64(ph + 32, be) : rd32(ph + 16, be);
+        uint64_t p_memsz = is64 ? rd64(ph + 40, be) : rd32(ph + 20, be);
+        uint64_t p_align = is64 ? rd64(ph + 48, be) : rd32(ph + 28, be);
+
+        if (p_type >= PT_NUM && p_type < PT_LOOS) return VALIDATE_BAD;
+        if (p_flags & ~(uint32_t)(PF_R | PF_W | PF_X | PF_MASKOS | PF_MASKPROC))
+            return VALIDATE_BAD;
+        if (p_align & (p_align - 1)) return VALIDATE_BAD;
+
+        if (p_type == PT_LOAD) {
+            loads++;
+            if (p_memsz < p_filesz) return VALIDATE_BAD;
+            if (p_align > 1 && (p_vaddr - p_offset) % p_align != 0) return VALIDATE_BAD;
+        } else if (p_type == PT_PHDR && p_offset != phoff) {
+            return VALIDATE_BAD;
+        }
+    }
+
+    if ((type == ET_EXEC || type == ET_DYN) && loads == 0) return VALIDATE_BAD;
+    return VALIDATE_OK;
+}
+
+/* ----------------------------------------------------------------- PDF */
+
+// "<digits> <digits> obj" at p
+static int is_obj_header(const unsigned char *p, const unsigned char *end) {
+    int fields = 0;
+    while (fields < 2) {
+        if (p >= end || !is_digit(*p)) return 0;
+        while (p < end && is_digit(*p)) p++;
+        if (p >= end || !is_pdf_space(*p)) return 0;
+        while (p < end && is_pdf_space(*p)) p++;
+        fields++;
+    }
+    return end - p >= 3 && memcmp(p, "obj", 3) == 0;
+}
+
+// Classic cross-reference table: "xref" then "<first> <count>" and
+// fixed 20-byte entries "oooooooooo ggggg n\r\n"
+static int is_xref_table(const unsigned char *p, const unsigned char *end) {
+    if (end - p < 4 || memcmp(p, "xref", 4) != 0) return 0;
+    p += 4;
+    while (p < end && is_pdf_space(*p)) p++;
+
+    for (int field = 0; field < 2; field++) {
+        if (p >= end || !is_digit(*p)) return 0;
+        while (p < end && is_digit(*p)) p++;
+        while (p < end && (*p == ' ' || *p == '\r' || *p == '\n')) p++;
+    }
+
+    for (int e = 0; e < PDF_XREF_ENTRIES && end - p >= 20; e++, p += 20) {
+        for (int k = 0; k < 10; k++) if (!is_digit(p[k])) return 0;
+        if (p[10] != ' ') return 0;
+        for (int k = 11; k < 16; k++) if (!is_digit(p[k])) return 0;
+        if (p[16] != ' ' || (p[17] != 'n' && p[17] != 'f')) return 0;
+        if ((p[18] != ' ' && p[18] != '\r') || (p[19] != '\r' && p[19] != '\n')) return 0;
+    }
+    return 1;
+}
+
+static validate_result_t validate_pdf(const unsigned char *buf, size_t len) {
+    if (len < 8) return VALIDATE_UNKNOWN;
+    if (!is_digit(buf[5]) || buf[6] != '.' || !is_digit(buf[7])) return VALIDATE_BAD;
+
+    // Head: first indirect object must follow the header (and optional
+    // binary comment line) closely
+    size_t head = len < PDF_HEAD_WINDOW ? len : PDF_HEAD_WINDOW;
+    const unsigned char *end = buf + head;
+    const unsigned char *obj = NULL;
+    for (const unsigned char *p = buf + 8; p < end; p++) {
+        if (is_digit(*p) && is_pdf_space(p[-1]) && is_obj_header(p, end)) {
+            obj = p;
+            break;
+        }
+    }
+    if (!obj) return len < PDF_HEAD_WINDOW ? VALIDATE_UNKNOWN : VALIDATE_BAD;
+
+    // Tail: when this write carries the trailer, startxref must point at a
+    // real cross-reference table or xref stream inside the file
+    size_t tail = len < PDF_TAIL_WINDOW ? len : PDF_TAIL_WINDOW;
+    const unsigned char *tail_start = buf + len - tail;
+    const unsigned char *sx = find_bytes(tail_start, tail, "startxref");
+    if (!sx) return VALIDATE_OK;  // Trailer lands in a later write
+
+    const unsigned char *p = sx + 9;
+    const unsigned char *buf_end = buf + len;
+    while (p < buf_end && is_pdf_space(*p)) p++;
+    if (p >= buf_end || !is_digit(*p)) return VALIDATE_BAD;
+
+    uint64_t xref_off = 0;
+    while (p < buf_end && is_digit(*p) && xref_off < len) {
+        xref_off = xref_off * 10 + (uint64_t)(*p++ - '0');
+    }
+    if (xref_off >= len) return VALIDATE_BAD;
+    if (!find_bytes(p, (size_t)(buf_end - p), "%%EOF")) return VALIDATE_BAD;
+
+    const unsigned char *xref = buf + xref_off;
+    if (is_xref_table(xref, buf_end) || is_obj_header(xref, buf_end)) {
+        return VALIDATE_OK;
+    }
+    return VALIDATE_BAD;
+}
+
+/* ----------------------------------------------------------------- ZIP */
+
+#define ZIP_FLAG_RESERVED  0xd780u     // Bits 7-10, 12, 14, 15
+#define DEFLATE_PROBE_BYTES (1 << 20)  // Compressed bytes inflated per probe, a whole write
+
+static int zip_method_known(uint16_t m) {
+    switch (m) {
+    case 0: case 1: case 6: case 8: case 9: case 12: case 14:
+    case 19: case 93: case 95: case 96: case 97: case 98: case 99:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// MS-DOS date/time; all-zero is written by some tools and accepted
+static int zip_dostime_ok(uint16_t t, uint16_t d) {
+    if (d == 0 && t == 0) return 1;
+    unsigned month = (d >> 5) & 0x0f, day = d & 0x1f;
+    unsigned hour = t >> 11, min = (t >> 5) & 0x3f, sec2 = t & 0x1f;
+    return month >= 1 && month <= 12 && day >= 1 && hour < 24 && min < 60 && sec2 < 30;
+}
+
+static int zip_name_ok(const unsigned char *name, size_t n) {
+    if (n == 0 || n > ZIP_MAX_NAME) return 0;
+    for (size_t i = 0; i < n; i++) {
+        if (name[i] < 0x20 || name[i] == 0x7f) return 0;
+    }
+    return 1;
+}
+
+// Extra field must be a chain of (id, size) records that fills it exactly;
+// zipalign-style zero padding shorter than a record header is tolerated.
+// Picks ZIP64 sizes out of the 0x0001 record when the header says so.
+static int zip_extra_ok(const unsigned char *ex, size_t n, uint64_t *usize, uint64_t *csize) {
+    size_t i = 0;
+    while (i + 4 <= n) {
+        uint16_t id = rd16(ex + i, 0), sz = rd16(ex + i + 2, 0);
+        if (i + 4 + sz > n) return 0;
+        if (id == 0x0001) {
+            size_t k = i + 4, k_end = i + 4 + sz;
+            if (*usize == 0xffffffffu && k + 8 <= k_end) { *usize = rd64(ex + k, 0); k += 8; }
+            if (*csize == 0xffffffffu && k + 8 <= k_end) { *csize = rd64(ex + k, 0); }
+        }
+        i += 4 + (size_t)sz;
+    }
+    for (; i < n; i++) {
+        if (ex[i] != 0) return 0;
+    }
+    return 1;
+}
+
+// Type of the deflate block whose 3-bit header starts at bit offset 'bit'
+// (LSB first), -1 if the header is not all in the data
+static int block_type(const unsigned char *data, size_t len, uint64_t bit) {
+    if (bit + 3 > (uint64_t)len * 8) return -1;
+    unsigned v = 0;
+    for (int i = 0; i < 3; i++, bit++) v |= (unsigned)(data[bit / 8] >> (bit % 8) & 1) << i;
+    return (int)(v >> 1);  // BFINAL is bit 0
+}
+
+long deflate_probe(const unsigned char *data, size_t len, int *complete) {
+    unsigned char out[4096];
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    *complete = 0;
+    if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) return 0;  // Can't tell: vouch for nothing, accuse nobody
+
+    size_t avail = len < DEFLATE_PROBE_BYTES ? len : DEFLATE_PROBE_BYTES;
+    zs.next_in = (unsigned char *)data;
+    zs.avail_in = (uInt)avail;
+
+    // One block at a time (Z_BLOCK), so a stored block is seen coming: its
+    // bytes are copied raw and could be anything
+    long checked = 0;
+    uint64_t bit = 0;
+    int ret;
+    for (;;) {
+        int type = block_type(data, avail, bit);
+        if (type == 0) {
+            ret = Z_OK;
+            break;
+        }
+        if (type == 3) {
+            ret = Z_DATA_ERROR;
+            break;
+        }
+        do {
+            zs.next_out = out;
+            zs.avail_out = sizeof(out);
+            ret = inflate(&zs, Z_BLOCK);
+        } while (ret == Z_OK && !(zs.data_type & 128) && zs.avail_in > 0);
+
+        if (ret != Z_OK && ret != Z_BUF_ERROR) break;
+        size_t used = avail - zs.avail_in;
+        checked = (long)used;
+        if (ret == Z_BUF_ERROR || !(zs.data_type & 128)) break;
+        if (zs.data_type & 64) {  // End of the last block
+            *complete = 1;
+            break;
+        }
+        bit = (uint64_t)used * 8 - (zs.data_type & 7);  // Next block header
+    }
+
+    inflateEnd(&zs);
+    return ret == Z_DATA_ERROR ? -1 : checked;
+}
+
+validate_result_t zip_local_record(const unsigned char *p, size_t avail, zip_record_t *rec) {
+    if (avail < 30) return VALIDATE_UNKNOWN;
+
+    uint16_t need = rd16(p + 4, 0), flags = rd16(p + 6, 0), method = rd16(p + 8, 0);
+    uint64_t csize = rd32(p + 18, 0), usize = rd32(p + 22, 0);
+    uint16_t nlen = rd16(p + 26, 0), elen = rd16(p + 28, 0);
+
+    if ((need & 0xff) > 63 || (flags & ZIP_FLAG_RESERVED)) return VALIDATE_BAD;
+    if (!zip_method_known(method)) return VALIDATE_BAD;
+    if (!zip_dostime_ok(rd16(p + 10, 0), rd16(p + 12, 0))) return VALIDATE_BAD;
+    if (nlen == 0 || nlen > ZIP_MAX_NAME) return VALIDATE_BAD;
+
+    size_t header_len = 30 + (size_t)nlen + elen;
+    if (avail < header_len) return VALIDATE_UNKNOWN;
+    if (!zip_name_ok(p + 30, nlen)) return VALIDATE_BAD;
+    if (!zip_extra_ok(p + 30 + nlen, elen, &usize, &csize)) return VALIDATE_BAD;
+    if (method == 0 && !(flags & ZIP_FLAG_ENCRYPTED) && !(flags & ZIP_FLAG_DESCRIPTOR) &&
+        csize != usize)
+        return VALIDATE_BAD;
+
+    rec->csize = csize;
+    rec->flags = flags;
+    rec->method = method;
+    rec->header_len = header_len;
+    return VALIDATE_OK;
+}
+
+validate_result_t zip_central_record(const unsigned char *p, size_t avail, zip_record_t *rec) {
+    if (avail < 46) return VALIDATE_UNKNOWN;
+
+    uint16_t flags = rd16(p + 8, 0), method = rd16(p + 10, 0);
+    uint16_t nlen = rd16(p + 28, 0), elen = rd16(p + 30, 0), clen = rd16(p + 32, 0);
+
+    if ((rd16(p + 6, 0) & 0xff) > 63 || (flags & ZIP_FLAG_RESERVED)) return VALIDATE_BAD;
+    if (!zip_method_known(method)) return VALIDATE_BAD;
+    if (!zip_dostime_ok(rd16(p + 12, 0), rd16(p + 14, 0))) return VALIDATE_BAD;
+    if (nlen == 0 || nlen > ZIP_MAX_NAME) return VALIDATE_BAD;
+    if (avail < 46 + (size_t)nlen) return VALIDATE_UNKNOWN;
+    if (!zip_name_ok(p + 46, nlen)) return VALIDATE_BAD;
+
+    rec->csize = rd32(p + 20, 0);
+    rec->flags = flags;
+    rec->method = method;
+    rec->header_len = 46 + (size_t)nlen + elen + clen;
+    return VALIDATE_OK;
+}
+
+validate_result_t zip_member_data(const zip_record_t *rec, const unsigned char *data, size_t avail) {
+    if (!(rec->flags & ZIP_FLAG_DESCRIPTOR) && rec->csize < avail) avail = (size_t)rec->csize;
+    if (avail == 0) return VALIDATE_OK;
+    // Stored, encrypted or other-method data could be anything, ciphertext included
+    if (rec->method != ZIP_METHOD_DEFLATE || (rec->flags & ZIP_FLAG_ENCRYPTED)) return VALIDATE_UNKNOWN;
+
+    // Only bytes that really inflated are vouched for: not stored deflate
+    // blocks, nor what lies past the probe. A streamed member may end early.
+    int complete;
+    long checked = deflate_probe(data, avail, &complete);
+    if (checked < 0) return VALIDATE_BAD;
+    if ((size_t)checked == avail || (complete && (rec->flags & ZIP_FLAG_DESCRIPTOR))) return VALIDATE_OK;
+    return VALIDATE_UNKNOWN;
+}
+
+static validate_result_t validate_zip(const unsigned char *buf, size_t len) {
+    size_t pos = 0;
+    int locals = 0, opaque = 0;
+
+    for (int rec_no = 0; rec_no < ZIP_MAX_RECORDS && pos + 4 <= len; rec_no++) {
+        const unsigned char *p = buf + pos;
+        uint32_t sig = rd32(p, 0);
+        zip_record_t rec;
+
+        if (sig == ZIP_SIG_LOCAL) {
+            validate_result_t r = zip_local_record(p, len - pos, &rec);
+            if (r != VALIDATE_OK) {
+                if (r == VALIDATE_BAD) return VALIDATE_BAD;
+                break;
+            }
+            locals++;
+
+            size_t data = pos + rec.header_len;
+            validate_result_t d = zip_member_data(&rec, buf + data, len - data);
+            if (d == VALIDATE_BAD) return VALIDATE_BAD;
+            if (d == VALIDATE_UNKNOWN) opaque = 1;  // Keep walking: later records may still be broken
+
+            // Streamed members (data descriptor, sizes unknown) can't be skipped
+            if ((rec.flags & ZIP_FLAG_DESCRIPTOR) && rec.csize == 0) break;
+
+            uint64_t next = data + rec.csize;
+            if (rec.flags & ZIP_FLAG_DESCRIPTOR) {
+                if (next + 4 <= len && rd32(buf + next, 0) == ZIP_SIG_DESCRIPTOR) next += 4;
+                next += 12;
+            }
+            if (next > len) break;
+            pos = (size_t)next;
+        } else if (sig == ZIP_SIG_CENTRAL) {
+            validate_result_t r = zip_central_record(p, len - pos, &rec);
+            if (r != VALIDATE_OK) {
+                if (r == VALIDATE_BAD) return VALIDATE_BAD;
+                break;
+            }
+            pos += rec.header_len;
+        } else if (sig == ZIP_SIG_EOCD) {
+            if (pos + 22 > len) break;
+            uint16_t on_disk = rd16(p + 8, 0), total = rd16(p + 10, 0);
+            uint32_t cd_size = rd32(p + 12, 0), cd_off = rd32(p + 16, 0);
+
+            if (on_disk > total) return VALIDATE_BAD;
+            // Central directory precedes the end record (0xffffffff = see ZIP64)
+            if (cd_off != 0xffffffffu && (uint64_t)cd_off + cd_size > pos) return VALIDATE_BAD;
+            return opaque ? VALIDATE_UNKNOWN : VALIDATE_OK;
+        } else if (sig == ZIP_SIG_EOCD64) {
+            if (pos + 12 > len) break;
+            uint64_t next = pos + 12 + rd64(p + 4, 0);
+            if (next > len) break;
+            pos = (size_t)next;
+        } else if (sig == ZIP_SIG_LOCATOR64) {
+            pos += 20;
+        } else if (sig == ZIP_SIG_DIGSIG) {
+            if (pos + 6 > len) break;
+            pos += 6 + (size_t)rd16(p + 4, 0);
+        } else if (sig == ZIP_SIG_DESCRIPTOR && pos == 0) {
+            pos += 4;  // Split-archive marker
+        } else {
+            return VALIDATE_BAD;  // Record boundary without a record
+        }
+    }
+
+    return locals > 0 && !opaque ? VALIDATE_OK : VALIDATE_UNKNOWN;
+}
+
+/* ------------------------------------------------------------ dispatch */
+
+validate_result_t validate_structure(const unsigned char *buffer, size_t len,
+                                     const char **format) {
+    validate_result_t res;
+    const char *name;
+
+    if (len >= 4 && memcmp(buffer, ELFMAG, SELFMAG) == 0) {
+        name = "elf";
+        res = validate_elf(buffer, len);
+    } else if (len >= 5 && memcmp(buffer, "%PDF-", 5) == 0) {
+        name = "pdf";
+        res = validate_pdf(buffer, len);
+    } else if (len >= 4 && buffer[0] == 'P' && buffer[1] == 'K' &&
+               buffer[2] < 0x09 && buffer[3] < 0x09) {
+        name = "zip";
+        res = validate_zip(buffer, len);
+    } else if (len >= 2 && buffer[0] == '#' && buffer[1] == '!') {
+        name = "script";
+        res = validate_script(buffer, len);
+    } else {
+        name = "text";
+        res = is_text(buffer, len) ? VALIDATE_OK : VALIDATE_UNKNOWN;
+    }
+
+    if (format) *format = res == VALIDATE_UNKNOWN ? NULL : name;
+    return res;
+}
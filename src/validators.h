@@ -0,0 +1,61 @@
+/*
+ * SentinelFS - Structural validators
+ *
+ * Purpose-built parsers for the whitelisted formats (ELF, PDF, ZIP, shell
+ * scripts, text). Each validator looks at a bounded number of bytes and
+ * checks that the structure behind the magic bytes is real, so a fake
+ * header prepended to ciphertext is rejected without calling LibMagic.
+ */
+
+#ifndef SENTINELFS_VALIDATORS_H
+#define SENTINELFS_VALIDATORS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    VALIDATE_UNKNOWN = 0,  // No signature we know, caller decides (LibMagic fallback)
+    VALIDATE_OK,           // Signature present and structure checks out
+    VALIDATE_BAD           // Signature present but structure is broken (fake header)
+} validate_result_t;
+
+// Run every validator against the buffer. On OK/BAD, *format (if not NULL)
+// is set to a short static name of the detected format.
+validate_result_t validate_structure(const unsigned char *buffer, size_t len,
+                                     const char **format);
+
+// Trial-inflate raw deflate data, block by block, stopping short of a
+// stored block. Returns -1 if zlib reports a format error, else how many
+// leading bytes inflated; *complete is set if the stream ended there.
+long deflate_probe(const unsigned char *data, size_t len, int *complete);
+
+// ZIP record checks, shared with the streaming parser
+#define ZIP_SIG_LOCAL       0x04034b50u
+#define ZIP_SIG_CENTRAL     0x02014b50u
+#define ZIP_SIG_EOCD        0x06054b50u
+#define ZIP_SIG_EOCD64      0x06064b50u
+#define ZIP_SIG_LOCATOR64   0x07064b50u
+#define ZIP_SIG_DESCRIPTOR  0x08074b50u
+#define ZIP_SIG_DIGSIG      0x05054b50u
+#define ZIP_FLAG_ENCRYPTED  0x0001u
+#define ZIP_FLAG_DESCRIPTOR 0x0008u
+#define ZIP_METHOD_DEFLATE  8
+
+typedef struct {
+    uint64_t csize;     // Compressed size (ZIP64 resolved); 0 for streamed members
+    uint16_t flags;
+    uint16_t method;
+    size_t header_len;  // Fixed part + name + extra (+ comment for central records)
+} zip_record_t;
+
+// p points at the signature. UNKNOWN means avail is too short to decide.
+validate_result_t zip_local_record(const unsigned char *p, size_t avail, zip_record_t *rec);
+validate_result_t zip_central_record(const unsigned char *p, size_t avail, zip_record_t *rec);
+
+// Member data bytes available after a local header: BAD if deflate data
+// fails deflate_probe, UNKNOWN if stored, encrypted or another method
+// (nothing to verify) or if not all of it inflated (stored deflate blocks),
+// OK if all of it inflated or none is here
+validate_result_t zip_member_data(const zip_record_t *rec, const unsigned char *data, size_t avail);
+
+#endif /* SENTINELFS_VALIDATORS_H */
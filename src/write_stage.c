@@ -0,0 +1,253 @@
+/*
+ * SentinelFS - Small-write staging window
+ *
+ * Runs live in an inode_table, so at most WRITE_STAGE_FILES files hold one
+ * at a time; evicting a file lands its run. A run is landed with its set
+ * locked, so a later write to the same file can never overtake it. An
+ * error an evicted file still owed its writer moves to a short list of
+ * orphans until that writer syncs or writes again.
+ */
+
+#include "write_stage.h"
+#include "inode_table.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char path[PATH_MAX];  // FUSE path of the run's first write
+    unsigned char *buf;   // Window-sized while a run is staged
+    size_t len;
+    off_t offset;
+    pid_t pid;
+    int error;            // A forced flush failed, not yet reported to the writer
+    pid_t error_pid;      // That writer
+    dev_t dev;
+    ino_t ino;
+} stage_t;
+
+typedef struct {
+    dev_t dev;
+    ino_t ino;
+    pid_t pid;
+    int error;
+} orphan_t;
+
+static inode_table_t *table;
+static size_t window;
+static write_stage_flush_fn flush_fn;
+static _Atomic long entries;  // Files in the table
+
+static pthread_mutex_t orphan_lock = PTHREAD_MUTEX_INITIALIZER;
+static orphan_t orphan[WRITE_STAGE_ORPHANS];
+static _Atomic long orphans;  // Used slots, oldest first
+
+static struct {
+    _Atomic unsigned long staged;      // Writes held in a window
+    _Atomic unsigned long runs;        // Runs landed
+    _Atomic unsigned long long bytes;  // Bytes in those runs
+    _Atomic unsigned long forced;      // Landed early for a read, stat, sync, truncate, ...
+    _Atomic unsigned long failed;      // Blocked by detection or failed to write
+    _Atomic unsigned long lost;        // Errors dropped with no writer left to tell
+} sstats;
+
+// Evaluate and write the run
+static int land(stage_t *s) {
+    if (s->len == 0) return 0;
+
+    int res = flush_fn(s->path, s->buf, s->len, s->offset, s->pid);
+    if (res >= 0 && (size_t)res != s->len) res = -EIO;
+
+    atomic_fetch_add_explicit(&sstats.runs, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&sstats.bytes, s->len, memory_order_relaxed);
+    if (res < 0) atomic_fetch_add_explicit(&sstats.failed, 1, memory_order_relaxed);
+
+    free(s->buf);
+    s->buf = NULL;
+    s->len = 0;
+    return res < 0 ? res : 0;
+}
+
+// Land a run on its writer's behalf: a failure waits for that writer
+static int land_forced(stage_t *s) {
+    pid_t pid = s->pid;
+    int res = land(s);
+    if (res < 0 && s->error == 0) {
+        s->error = res;
+        s->error_pid = pid;
+    }
+    return res;
+}
+
+static void orphan_add(const stage_t *s) {
+    pthread_mutex_lock(&orphan_lock);
+    long n = atomic_load_explicit(&orphans, memory_order_relaxed);
+    if (n == WRITE_STAGE_ORPHANS) {
+        memmove(&orphan[0], &orphan[1], (n - 1) * sizeof(orphan_t));
+        n--;
+        atomic_fetch_add_explicit(&sstats.lost, 1, memory_order_relaxed);
+    }
+    orphan[n] = (orphan_t){ s->dev, s->ino, s->error_pid, s->error };
+    atomic_store_explicit(&orphans, n + 1, memory_order_relaxed);
+    pthread_mutex_unlock(&orphan_lock);
+}
+
+// Take the file's orphaned error, if pid (0 = anyone) is the one it is owed to
+static int orphan_take(dev_t dev, ino_t ino, pid_t pid) {
+    if (atomic_load_explicit(&orphans, memory_order_relaxed) == 0) return 0;
+
+    int error = 0;
+    pthread_mutex_lock(&orphan_lock);
+    long n = atomic_load_explicit(&orphans, memory_order_relaxed);
+    for (long i = 0; i < n; i++) {
+        if (orphan[i].dev != dev || orphan[i].ino != ino || (pid && orphan[i].pid != pid)) continue;
+        error = orphan[i].error;
+        memmove(&orphan[i], &orphan[i + 1], (n - i - 1) * sizeof(orphan_t));
+        atomic_store_explicit(&orphans, n - 1, memory_order_relaxed);
+        break;
+    }
+    pthread_mutex_unlock(&orphan_lock);
+    return error;
+}
+
+static void evict(void *value) {
+    stage_t *s = value;
+    land_forced(s);
+    if (s->error) orphan_add(s);
+    atomic_fetch_sub_explicit(&entries, 1, memory_order_relaxed);
+}
+
+// Drop the file once it holds nothing, else just unlock it
+static void release(stage_t *s) {
+    if (s->len == 0 && s->error == 0) {
+        inode_table_remove(table, s);
+    } else {
+        inode_table_put(table, s);
+    }
+}
+
+int write_stage_init(unsigned window_kb, write_stage_flush_fn flush) {
+    if (!window_kb) return 0;
+
+    window = (size_t)window_kb * 1024;
+    flush_fn = flush;
+    table = inode_table_create(WRITE_STAGE_FILES, sizeof(stage_t), evict);
+    return table ? 0 : -1;
+}
+
+void write_stage_destroy(void) {
+    inode_table_destroy(table);
+    table = NULL;
+}
+
+int write_stage_enabled(void) {
+    return table != NULL;
+}
+
+int write_stage_pending(void) {
+    return table && (atomic_load_explicit(&entries, memory_order_relaxed) > 0 ||
+                     atomic_load_explicit(&orphans, memory_order_relaxed) > 0);
+}
+
+int write_stage_write(const struct stat *st, const char *path, const char *buf, size_t size,
+                      off_t offset, pid_t pid) {
+    if (!table || !S_ISREG(st->st_mode)) return 0;
+
+    // A large write only needs to land what is staged ahead of it
+    int small = size < window;
+    int res = orphan_take(st->st_dev, st->st_ino, pid);
+    int created;
+    stage_t *s = inode_table_get(table, st->st_dev, st->st_ino, small, &created);
+    if (!s) return res;
+    if (created) {
+        s->dev = st->st_dev;
+        s->ino = st->st_ino;
+        atomic_fetch_add_explicit(&entries, 1, memory_order_relaxed);
+    }
+
+    // The writer hears of its own runs only: another process's write lands
+    // their run on their behalf and goes on
+    if (res == 0 && s->error && s->error_pid == pid) {
+        res = s->error;
+        s->error = 0;
+    }
+    if (res == 0 && s->len > 0 &&
+        (!small || pid != s->pid || offset != s->offset + (off_t)s->len || s->len + size > window)) {
+        if (pid == s->pid) {
+            res = land(s);
+        } else {
+            land_forced(s);
+        }
+    }
+
+    int staged = 0;
+    if (res == 0 && small && (s->buf || (s->buf = malloc(window)))) {
+        if (s->len == 0) {
+            snprintf(s->path, sizeof(s->path), "%s", path);
+            s->offset = offset;
+            s->pid = pid;
+        }
+        memcpy(s->buf + s->len, buf, size);
+        s->len += size;
+        staged = 1;
+        atomic_fetch_add_explicit(&sstats.staged, 1, memory_order_relaxed);
+
+        if (s->len == window) res = land(s);  // Full, nothing more can join it
+    }
+
+    release(s);
+    return res < 0 ? res : staged;
+}
+
+int write_stage_flush(dev_t dev, ino_t ino, off_t offset, size_t len) {
+    if (!write_stage_pending()) return 0;
+
+    stage_t *s = inode_table_get(table, dev, ino, 0, NULL);
+    if (!s) return 0;
+
+    int landed = 0;
+    if (s->len > 0 &&
+        (len == 0 || (offset < s->offset + (off_t)s->len && s->offset < offset + (off_t)len))) {
+        atomic_fetch_add_explicit(&sstats.forced, 1, memory_order_relaxed);
+        landed = land_forced(s) == 0;
+    }
+
+    release(s);
+    return landed;
+}
+
+int write_stage_sync(dev_t dev, ino_t ino) {
+    if (!write_stage_pending()) return 0;
+
+    int res = orphan_take(dev, ino, 0);
+    stage_t *s = inode_table_get(table, dev, ino, 0, NULL);
+    if (!s) return res;
+
+    if (res == 0) res = s->error;
+    s->error = 0;
+    if (s->len > 0) {
+        atomic_fetch_add_explicit(&sstats.forced, 1, memory_order_relaxed);
+        int landed = land(s);
+        if (res == 0) res = landed;
+    }
+
+    release(s);
+    return res;
+}
+
+void write_stage_print_stats(FILE *out) {
+    if (!window) {
+        fprintf(out, "  Write staging: off\n");
+        return;
+    }
+    unsigned long runs = atomic_load(&sstats.runs);
+    fprintf(out, "  Write staging: %lu writes staged, %lu runs landed (avg %.1f KB, %lu forced early, %lu failed, %lu errors lost), window %zu KB\n",
+            atomic_load(&sstats.staged), runs,
+            runs > 0 ? atomic_load(&sstats.bytes) / 1024.0 / runs : 0.0,
+            atomic_load(&sstats.forced), atomic_load(&sstats.failed),
+            atomic_load(&sstats.lost), window / 1024);
+}
@@ -0,0 +1,60 @@
+/*
+ * SentinelFS - Small-write staging window
+ *
+ * Detection on a lone 4KB write is noisy (entropy over 4096 bytes has a
+ * wide spread) and pays the pipeline's fixed cost every time. Writes
+ * smaller than the window are held per file instead. Each one that extends
+ * the staged run is appended. The run is evaluated and written as one
+ * buffer once the window fills, or once the next write does not continue
+ * it or comes from another process.
+ *
+ * Anything that could observe the file lands the staged run first: fsync
+ * and close, a read overlapping it, stat, truncate, unlink and rename. A
+ * staged write returns success at once, so a run blocked later fails
+ * whichever write, fsync or close of its writer forced it. A run forced
+ * by anything else (another process's write, a read, eviction from the
+ * table) fails the writer's next write, fsync or close instead, the way
+ * write-back errors surface; the write that forced it goes on. fsync and
+ * close report such an error whoever calls them.
+ */
+
+#ifndef SENTINELFS_WRITE_STAGE_H
+#define SENTINELFS_WRITE_STAGE_H
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define WRITE_STAGE_WINDOW_DEFAULT 64  // KB
+#define WRITE_STAGE_WINDOW_MAX 1024    // KB
+#define WRITE_STAGE_FILES 256          // Files with a run staged at once
+#define WRITE_STAGE_ORPHANS 64         // Errors of evicted files kept for their writer
+
+// Evaluates and writes a staged run: bytes written or -errno. path is the
+// one the first write of the run came through.
+typedef int (*write_stage_flush_fn)(const char *path, const unsigned char *buf, size_t len,
+                                    off_t offset, pid_t pid);
+
+// window_kb: 0 = off, every write goes straight through
+int write_stage_init(unsigned window_kb, write_stage_flush_fn flush);
+// Flushes every staged run
+void write_stage_destroy(void);
+int write_stage_enabled(void);
+// Cheap check before looking up a file: is anything staged at all?
+int write_stage_pending(void);
+
+// Returns 1 if the write was staged, 0 if the caller must write it itself
+// (anything staged before it has landed), or -errno if a run of this
+// writer's failed to land, the write is then dropped.
+int write_stage_write(const struct stat *st, const char *path, const char *buf, size_t size,
+                      off_t offset, pid_t pid);
+// Land the file's staged run if it overlaps [offset, offset + len), len 0
+// meaning all of it. Returns 1 if anything reached the file.
+int write_stage_flush(dev_t dev, ino_t ino, off_t offset, size_t len);
+// fsync and close: land the run and return the error of any flush since
+// the writer last heard back
+int write_stage_sync(dev_t dev, ino_t ino);
+
+void write_stage_print_stats(FILE *out);
+
+#endif /* SENTINELFS_WRITE_STAGE_H */
@@ -0,0 +1,368 @@
+/*
+ * SentinelFS - Synthetic encryptor for time-to-detect measurements
+ *
+ * Behaves like ransomware on a test tree inside the mount: each file is
+ * read in full, XORed with a keystream and written back in place, chunk
+ * by chunk, optionally renamed to a new extension. Threads take files from
+ * a shared list; the file and byte rates are paced globally.
+ *
+ * Every file's first write is timestamped, and so is the first operation
+ * SentinelFS refuses (the block). Afterwards every chunk is read back and
+ * compared with a hash of its original content, so "lost" counts what
+ * really changed on disk, whatever the write calls reported (staged,
+ * quarantined or throttled writes included); a file that cannot be read
+ * back at all counts as lost. Finally the stats file at the mount root
+ * (-m, else the nearest directory above <dir> that has one) is searched
+ * for this process's own flag line.
+ *
+ * Usage: sentinelfs-encryptor [-j THREADS] [-f FILES/S] [-b MB/S]
+ *                             [-c CHUNK_KB] [-n MAX_FILES] [-e EXT]
+ *                             [-m MOUNT] <dir>
+ *
+ * Never point it at data you want to keep: without SentinelFS in front
+ * of it, everything it walks is encrypted (the key is not kept).
+ */
+
+#define _GNU_SOURCE  // nftw FTW_ACTIONRETVAL
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ENCRYPT_THREADS 1
+#define ENCRYPT_CHUNK_KB 64
+#define ENCRYPT_MAX_FILE_MB 256  // Larger files are left alone
+#define STATS_FILE ".sentinelfs_stats"
+
+typedef struct {
+    char path[PATH_MAX];
+    off_t size;
+    uint64_t *hashes;       // Original content, per chunk
+    uint64_t touched_ns;    // First write attempted, 0 = never
+    unsigned long refused;  // Operations on it that failed with EIO
+    int renamed;
+} file_t;
+
+static struct {
+    const char *dir;
+    int threads;
+    double files_per_sec;  // 0 = unpaced
+    double mb_per_sec;
+    size_t chunk;
+    size_t max_files;      // 0 = all
+    const char *ext;       // Rename encrypted files to name + ext
+    const char *mount;     // Mount root holding the stats file, NULL = search up from dir
+} opt = { NULL, ENCRYPT_THREADS, 0.0, 0.0, ENCRYPT_CHUNK_KB * 1024, 0, NULL, NULL };
+
+static file_t *files;
+static size_t nfiles, files_cap;
+static _Atomic size_t next_file;
+static uint64_t start_ns;
+static _Atomic uint64_t blocked_ns;        // First refused operation, 0 = none
+static _Atomic uint64_t file_slot, byte_slot;  // Pacing: next free start time
+static _Atomic unsigned long long bytes_written, bytes_refused;
+static _Atomic unsigned long ops_refused;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void sleep_ns(uint64_t ns) {
+    struct timespec ts = { (time_t)(ns / 1000000000ull), (long)(ns % 1000000000ull) };
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+    }
+}
+
+// Reserve cost_ns of a shared schedule and wait for its turn
+static void pace(_Atomic uint64_t *slot, uint64_t cost_ns) {
+    uint64_t now = now_ns();
+    uint64_t old = atomic_load(slot), begin;
+    do {
+        begin = old > now ? old : now;
+    } while (!atomic_compare_exchange_weak(slot, &old, begin + cost_ns));
+    if (begin > now) sleep_ns(begin - now);
+}
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static uint64_t hash(const unsigned char *buf, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ull ^ len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, buf + i, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+    }
+    for (; i < len; i++) h = (h ^ buf[i]) * 0x100000001b3ull;
+    return h;
+}
+
+static void refused(file_t *f, int err) {
+    if (err != EIO) return;
+    uint64_t now = now_ns(), none = 0;
+    atomic_compare_exchange_strong(&blocked_ns, &none, now);
+    atomic_fetch_add(&ops_refused, 1);
+    f->refused++;
+}
+
+static int collect(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    const char *name = path + ftw->base;
+    if (ftw->level > 0 && name[0] == '.') {
+        return type == FTW_D ? FTW_SKIP_SUBTREE : FTW_CONTINUE;  // Stats file, backups
+    }
+    if (type != FTW_F || !S_ISREG(st->st_mode) || st->st_size == 0 ||
+        st->st_size > (off_t)ENCRYPT_MAX_FILE_MB << 20) {
+        return FTW_CONTINUE;
+    }
+    if (nfiles == files_cap) {
+        files_cap = files_cap ? 2 * files_cap : 1024;
+        files = realloc(files, files_cap * sizeof(file_t));
+        if (!files) return FTW_STOP;
+    }
+    file_t *f = &files[nfiles++];
+    memset(f, 0, sizeof(*f));
+    snprintf(f->path, sizeof(f->path), "%s", path);
+    f->size = st->st_size;
+    return opt.max_files && nfiles == opt.max_files ? FTW_STOP : FTW_CONTINUE;
+}
+
+// Read it all, then overwrite it with the same bytes XOR a keystream
+static void encrypt(file_t *f, size_t index) {
+    int fd = open(f->path, O_RDWR);
+    if (fd == -1) {
+        fprintf(stderr, "%s: %s\n", f->path, strerror(errno));
+        return;
+    }
+
+    size_t chunks = (f->size + opt.chunk - 1) / opt.chunk;
+    unsigned char *data = malloc(f->size);
+    f->hashes = calloc(chunks, sizeof(uint64_t));
+    off_t got = 0;
+    while (data && got < f->size) {
+        ssize_t n = pread(fd, data + got, f->size - got, got);
+        if (n <= 0) break;
+        got += n;
+    }
+    if (!data || !f->hashes || got != f->size) {
+        fprintf(stderr, "%s: short read\n", f->path);
+        free(data);
+        close(fd);
+        return;
+    }
+
+    uint64_t state = 0x5eed0000ull + index;
+    for (size_t c = 0; c < chunks; c++) {
+        size_t off = c * opt.chunk;
+        size_t len = f->size - off < opt.chunk ? f->size - off : opt.chunk;
+        f->hashes[c] = hash(data + off, len);
+        for (size_t i = 0; i < len; i += 8) {
+            uint64_t k = splitmix64(&state);
+            for (size_t b = 0; b < 8 && i + b < len; b++) data[off + i + b] ^= (unsigned char)(k >> (8 * b));
+        }
+    }
+
+    for (size_t c = 0; c < chunks; c++) {
+        size_t off = c * opt.chunk;
+        size_t len = f->size - off < opt.chunk ? f->size - off : opt.chunk;
+        if (opt.mb_per_sec > 0) pace(&byte_slot, (uint64_t)(len / (opt.mb_per_sec * 1048576.0) * 1e9));
+        if (!f->touched_ns) f->touched_ns = now_ns();
+
+        ssize_t n = pwrite(fd, data + off, len, off);
+        if (n == (ssize_t)len) {
+            atomic_fetch_add(&bytes_written, len);
+        } else {
+            refused(f, n == -1 ? errno : EIO);
+            atomic_fetch_add(&bytes_refused, len);
+        }
+    }
+
+    // Staged writes are judged when they land, at the latest on close
+    if (fsync(fd) == -1) refused(f, errno);
+    if (close(fd) == -1) refused(f, errno);
+    free(data);
+
+    if (opt.ext) {
+        char to[PATH_MAX];
+        if ((size_t)snprintf(to, sizeof(to), "%s%s", f->path, opt.ext) >= sizeof(to)) return;
+        if (rename(f->path, to) == 0) {
+            snprintf(f->path, sizeof(f->path), "%s", to);
+            f->renamed = 1;
+        } else {
+            refused(f, errno);
+        }
+    }
+}
+
+static void *worker(void *arg) {
+    (void) arg;
+    for (;;) {
+        size_t i = atomic_fetch_add(&next_file, 1);
+        if (i >= nfiles) return NULL;
+        if (opt.files_per_sec > 0) pace(&file_slot, (uint64_t)(1e9 / opt.files_per_sec));
+        encrypt(&files[i], i);
+    }
+}
+
+// Bytes of f that no longer match the original; all of them if it is gone
+static off_t damage(const file_t *f) {
+    if (!f->hashes) return 0;
+    int fd = open(f->path, O_RDONLY);
+    if (fd == -1) return f->size;
+
+    unsigned char *buf = malloc(opt.chunk);
+    off_t lost = 0;
+    for (size_t c = 0; buf && (off_t)(c * opt.chunk) < f->size; c++) {
+        size_t off = c * opt.chunk;
+        size_t len = f->size - off < opt.chunk ? f->size - off : opt.chunk;
+        ssize_t n = pread(fd, buf, len, off);
+        if (n != (ssize_t)len || hash(buf, len) != f->hashes[c]) lost += len;
+    }
+    free(buf);
+    close(fd);
+    return lost;
+}
+
+// The stats file only exists at the mount root: -m, or the nearest
+// directory from dir up that has one
+static FILE *open_stats(void) {
+    char dir[PATH_MAX], path[PATH_MAX + sizeof(STATS_FILE)];
+    if (!realpath(opt.mount ? opt.mount : opt.dir, dir)) return NULL;
+    for (;;) {
+        snprintf(path, sizeof(path), "%s/%s", strcmp(dir, "/") ? dir : "", STATS_FILE);
+        FILE *in = fopen(path, "r");
+        if (in || opt.mount || !strcmp(dir, "/")) return in;
+        char *slash = strrchr(dir, '/');
+        slash[slash == dir ? 1 : 0] = '\0';
+    }
+}
+
+// SentinelFS's own view: this process's line in the stats file
+static void print_sentinel_view(void) {
+    FILE *in = open_stats();
+    if (!in) {
+        printf("SentinelFS view:      no %s (not a SentinelFS mount?)\n", STATS_FILE);
+        return;
+    }
+
+    char needle[32], line[512];
+    snprintf(needle, sizeof(needle), "pid %d:", (int)getpid());
+    int found = 0;
+    while (fgets(line, sizeof(line), in)) {
+        char *p = strstr(line, needle);
+        if (p) {
+            printf("SentinelFS view:      %s", p);
+            found = 1;
+        }
+    }
+    if (!found) printf("SentinelFS view:      this process was not flagged\n");
+    fclose(in);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] <dir>\n", prog);
+    fprintf(stderr, "  -j THREADS  Files encrypted in parallel (default: %d)\n", ENCRYPT_THREADS);
+    fprintf(stderr, "  -f FILES    Start at most FILES files per second (default: unpaced)\n");
+    fprintf(stderr, "  -b MB       Write at most MB megabytes per second (default: unpaced)\n");
+    fprintf(stderr, "  -c KB       Write chunk size (default: %d)\n", ENCRYPT_CHUNK_KB);
+    fprintf(stderr, "  -n FILES    Stop after FILES files (default: all)\n");
+    fprintf(stderr, "  -e EXT      Rename each file to name+EXT afterwards, e.g. .locked\n");
+    fprintf(stderr, "  -m MOUNT    SentinelFS mount root, for its stats (default: searched up from <dir>)\n");
+    fprintf(stderr, "Encrypts every file under <dir> (a test tree inside the mount) and reports\n");
+    fprintf(stderr, "what was lost before SentinelFS stepped in. The key is not kept.\n");
+}
+
+int main(int argc, char *argv[]) {
+    int c;
+    while ((c = getopt(argc, argv, "j:f:b:c:n:e:m:")) != -1) {
+        switch (c) {
+        case 'j': opt.threads = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 'f': opt.files_per_sec = atof(optarg); break;
+        case 'b': opt.mb_per_sec = atof(optarg); break;
+        case 'c': opt.chunk = atoi(optarg) > 0 ? (size_t)atoi(optarg) * 1024 : opt.chunk; break;
+        case 'n': opt.max_files = (size_t)atoll(optarg); break;
+        case 'e': opt.ext = optarg; break;
+        case 'm': opt.mount = optarg; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    opt.dir = argv[optind];
+
+    if (nftw(opt.dir, collect, 64, FTW_PHYS | FTW_ACTIONRETVAL) == -1 || !files) {
+        fprintf(stderr, "No files to encrypt under %s\n", opt.dir);
+        return 1;
+    }
+    off_t total = 0;
+    for (size_t i = 0; i < nfiles; i++) total += files[i].size;
+    printf("Encrypting %zu files (%.1f MB) under %s with %d thread(s)\n", nfiles,
+           total / 1048576.0, opt.dir, opt.threads);
+
+    start_ns = now_ns();
+    pthread_t threads[opt.threads];
+    for (int i = 0; i < opt.threads; i++) pthread_create(&threads[i], NULL, worker, NULL);
+    for (int i = 0; i < opt.threads; i++) pthread_join(threads[i], NULL);
+    double elapsed = (now_ns() - start_ns) / 1e9;
+
+    // Lost before the block: touched before it; lost after: SentinelFS missed it
+    uint64_t blocked = atomic_load(&blocked_ns);
+    size_t lost_files = 0, lost_before = 0, touched_after = 0, renamed = 0;
+    off_t lost_bytes = 0, lost_bytes_before = 0;
+    for (size_t i = 0; i < nfiles; i++) {
+        file_t *f = &files[i];
+        off_t lost = damage(f);
+        int before = !blocked || (f->touched_ns && f->touched_ns < blocked);
+        if (lost) {
+            lost_files++;
+            lost_bytes += lost;
+            if (before) {
+                lost_before++;
+                lost_bytes_before += lost;
+            }
+        }
+        if (!before) touched_after++;
+        renamed += f->renamed;
+        free(f->hashes);
+    }
+
+    unsigned long long written = atomic_load(&bytes_written), denied = atomic_load(&bytes_refused);
+    printf("Elapsed:              %.3fs, %.1f MB/s attempted, %.1f files/s\n", elapsed,
+           (written + denied) / 1048576.0 / elapsed, nfiles / elapsed);
+    if (blocked) {
+        printf("First block:          %.3fs after start, %lu operations refused\n",
+               (blocked - start_ns) / 1e9, atomic_load(&ops_refused));
+    } else {
+        printf("First block:          never\n");
+    }
+    printf("Lost before block:    %zu files, %.2f MB\n", lost_before, lost_bytes_before / 1048576.0);
+    printf("Lost after block:     %zu files, %.2f MB\n", lost_files - lost_before,
+           (lost_bytes - lost_bytes_before) / 1048576.0);
+    printf("Saved:                %zu of %zu files (%zu attempted after the block)\n",
+           nfiles - lost_files, nfiles, touched_after);
+    printf("Writes accepted:      %.2f MB (%.2f MB refused), %zu files renamed\n",
+           written / 1048576.0, denied / 1048576.0, renamed);
+    print_sentinel_view();
+
+    free(files);
+    return 0;
+}
@@ -0,0 +1,387 @@
+/*
+ * SentinelFS - Restore backups after an incident
+ *
+ * Reads the backup index (mmap'd, one pass into a path hash table) and
+ * rebuilds files from their chunk manifests, pre-image journals or the
+ * hard-linked copies of removed files, many
+ * files in parallel. Works on the storage directory directly: stop the
+ * daemon, or restore into another directory with -o.
+ *
+ * Usage: sentinelfs-restore [-l] [-t EPOCH | -V VERSION] [-i INODE]
+ *                           [-o OUTDIR] [-j THREADS] <storage_path> [path...]
+ *
+ * Paths are relative to the storage root and select a file or a whole
+ * subtree (default: everything). For each file the latest version is
+ * restored; with -t, the state it had at that time (the first pre-image
+ * taken at or after it).
+ */
+
+#define _GNU_SOURCE  // copy_file_range()
+
+#include "backup.h"
+#include "backup_index.h"
+#include "chunk_store.h"
+#include "journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RESTORE_THREADS 4
+
+static struct {
+    const char *storage;
+    const char *outdir;
+    int list;
+    long long at_time;     // -t, -1 = latest
+    long long version;     // -V, -1 = any
+    long long inode;       // -i, -1 = any
+    int threads;
+    char **prefixes;       // Full paths selected
+    int nprefixes;
+} opt = { NULL, NULL, 0, -1, -1, -1, RESTORE_THREADS, NULL, 0 };
+
+static backup_index_map_t index_map;
+static char backup_dir[PATH_MAX - 256];  // Room for backup file names below it
+
+// Open addressing, path -> version to restore
+typedef struct {
+    const char *path;
+    const index_record_t *rec;
+} entry_t;
+
+static entry_t *table;
+static size_t table_mask;
+static entry_t **work;      // Occupied entries, handed out to threads
+static size_t nwork;
+static _Atomic size_t next_work;
+static _Atomic int failures;
+static uint64_t *deleted;   // Versions removed by the GC, sorted
+static size_t ndeleted;
+
+static uint64_t hash_path(const char *s) {
+    uint64_t h = 0xcbf29ce484222325ULL;  // FNV-1a
+    while (*s) h = (h ^ (unsigned char)*s++) * 0x100000001b3ULL;
+    return h;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static int removed(const index_record_t *r) {
+    return r->kind == INDEX_DELETED || bsearch(&r->version, deleted, ndeleted, sizeof(uint64_t), cmp_u64);
+}
+
+static int selected(const index_record_t *r) {
+    if (removed(r)) return 0;
+    if (opt.version >= 0 && r->version != (uint64_t)opt.version) return 0;
+    if (opt.inode >= 0 && r->ino != (uint64_t)opt.inode) return 0;
+    if (opt.at_time >= 0 && r->time < opt.at_time) return 0;
+
+    const char *path = index_record_path(r);
+    for (int i = 0; i < opt.nprefixes; i++) {
+        size_t n = strlen(opt.prefixes[i]);
+        if (strncmp(path, opt.prefixes[i], n) == 0 && (path[n] == '\0' || path[n] == '/' || n == 1)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Latest version, or with -t the earliest one at or after the time
+static int better(const index_record_t *r, const index_record_t *cur) {
+    if (opt.at_time >= 0) return r->time < cur->time || (r->time == cur->time && r->version < cur->version);
+    return r->version > cur->version;
+}
+
+static void add_record(const index_record_t *r) {
+    const char *path = index_record_path(r);
+    size_t i = hash_path(path) & table_mask;
+    while (table[i].path && strcmp(table[i].path, path) != 0) i = (i + 1) & table_mask;
+
+    if (!table[i].path) {
+        table[i].path = path;
+        table[i].rec = r;
+        work[nwork++] = &table[i];
+    } else if (better(r, table[i].rec)) {
+        table[i].rec = r;
+    }
+}
+
+static const char *kind_name(uint32_t kind) {
+    switch (kind) {
+    case INDEX_MANIFEST: return "manifest";
+    case INDEX_JOURNAL: return "journal";
+    case INDEX_PREIMAGE: return "preimage";
+    default: return "?";
+    }
+}
+
+static void print_record(const index_record_t *r) {
+    char when[32];
+    time_t t = r->time;
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&t));
+    printf("%8llu  %s  %12llu  %-8s  %s  (%s)\n", (unsigned long long)r->version, when,
+           (unsigned long long)r->size, kind_name(r->kind),
+           index_record_path(r), index_record_name(r));
+}
+
+static int mkdirs(char *path) {
+    for (char *p = path + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        int r = mkdir(path, 0755);
+        *p = '/';
+        if (r == -1 && errno != EEXIST) return -1;
+    }
+    return 0;
+}
+
+static int restore_manifest(const index_record_t *r, int fd) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", backup_dir, index_record_name(r));
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+
+    manifest_header_t h;
+    unsigned char *buf = malloc(CDC_MAX_SIZE);
+    int ok = buf && fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, MANIFEST_MAGIC, 8) == 0 &&
+             fseek(f, h.path_len, SEEK_CUR) == 0;
+
+    manifest_entry_t e;
+    uint64_t total = 0;
+    while (ok && fread(&e, sizeof(e), 1, f) == 1) {
+        ok = e.len <= CDC_MAX_SIZE && chunk_read(e.hash, buf, e.len) == 0 &&
+             write(fd, buf, e.len) == (ssize_t)e.len;
+        total += e.len;
+    }
+    fclose(f);
+    free(buf);
+    return ok && total == h.size ? 0 : -1;
+}
+
+static int apply_journal(const char *name, int fd) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", backup_dir, name);
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+
+    journal_header_t h;
+    unsigned char *buf = malloc(JOURNAL_BLOCK);
+    int ok = buf && fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, JOURNAL_MAGIC, 8) == 0 &&
+             fseek(f, h.path_len, SEEK_CUR) == 0;
+
+    journal_extent_t e;
+    while (ok && fread(&e, sizeof(e), 1, f) == 1) {
+        ok = e.len <= JOURNAL_BLOCK && fread(buf, 1, e.len, f) == e.len &&
+             pwrite(fd, buf, e.len, e.offset) == (ssize_t)e.len;
+    }
+    fclose(f);
+    free(buf);
+    return ok && ftruncate(fd, h.size) == 0 ? 0 : -1;
+}
+
+// Append the whole of src to fd, in the kernel
+static int copy_file(const char *src_path, int fd) {
+    int src = open(src_path, O_RDONLY);
+    if (src == -1) return -1;
+    struct stat st;
+    loff_t in = 0;
+    int ok = fstat(src, &st) == 0;
+    while (ok && in < st.st_size) {
+        ssize_t n = copy_file_range(src, &in, fd, NULL, st.st_size - in, 0);
+        ok = n > 0;
+    }
+    close(src);
+    return ok ? 0 : -1;
+}
+
+static int restore_preimage(const index_record_t *r, int fd) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", backup_dir, index_record_name(r));
+    return copy_file(path, fd);
+}
+
+// A journal holds the pre-images of one window, relative to the file as
+// the next window found it: start from the current file (or, if it was
+// removed since, the pre-image kept at removal) and undo every journal of
+// the path from the newest back to r
+static int restore_journal(const index_record_t *r, int fd) {
+    const index_record_t *base = NULL;
+    for (const index_record_t *p = backup_index_next(&index_map, NULL); p;
+         p = backup_index_next(&index_map, p)) {
+        if (p->kind == INDEX_PREIMAGE && p->version > r->version && !removed(p) &&
+            (!base || p->version < base->version) &&
+            strcmp(index_record_path(p), index_record_path(r)) == 0) {
+            base = p;
+        }
+    }
+    if (base ? restore_preimage(base, fd) != 0 : copy_file(index_record_path(r), fd) != 0) {
+        fprintf(stderr, "%s: journaled file is gone, nothing to apply the journal to\n",
+                index_record_path(r));
+        return -1;
+    }
+
+    uint64_t below = UINT64_MAX;
+    for (;;) {
+        const index_record_t *newest = NULL;
+        for (const index_record_t *j = backup_index_next(&index_map, NULL); j;
+             j = backup_index_next(&index_map, j)) {
+            if (j->kind == INDEX_JOURNAL && j->version >= r->version && j->version < below &&
+                (!base || j->version < base->version) &&
+                (!newest || j->version > newest->version) &&
+                strcmp(index_record_path(j), index_record_path(r)) == 0) {
+                newest = j;
+            }
+        }
+        if (!newest) return 0;
+        if (apply_journal(index_record_name(newest), fd) != 0) return -1;
+        below = newest->version;
+    }
+}
+
+static void restore_one(const index_record_t *r) {
+    const char *path = index_record_path(r);
+    char target[PATH_MAX], tmp[PATH_MAX];
+    if (opt.outdir) {
+        snprintf(target, sizeof(target), "%s%s", opt.outdir, path + strlen(opt.storage));
+    } else {
+        snprintf(target, sizeof(target), "%s", path);
+    }
+
+    int fd = -1;
+    errno = ENAMETOOLONG;
+    if (snprintf(tmp, sizeof(tmp), "%s.restore.XXXXXX", target) < (int)sizeof(tmp) && mkdirs(tmp) == 0) {
+        fd = mkstemp(tmp);
+    }
+    if (fd == -1) {
+        fprintf(stderr, "%s: %s\n", target, strerror(errno));
+        atomic_fetch_add(&failures, 1);
+        return;
+    }
+
+    int rc = r->kind == INDEX_JOURNAL ? restore_journal(r, fd)
+             : r->kind == INDEX_PREIMAGE ? restore_preimage(r, fd)
+             : restore_manifest(r, fd);
+    if (rc == 0) rc = fchmod(fd, r->mode & 07777);
+    close(fd);
+
+    if (rc != 0 || rename(tmp, target) != 0) {
+        fprintf(stderr, "%s: restore of version %llu failed\n", target, (unsigned long long)r->version);
+        unlink(tmp);
+        atomic_fetch_add(&failures, 1);
+        return;
+    }
+    printf("restored %s (version %llu, %llu bytes)\n", target, (unsigned long long)r->version,
+           (unsigned long long)r->size);
+}
+
+static void *restore_worker(void *arg) {
+    (void) arg;
+    for (;;) {
+        size_t i = atomic_fetch_add(&next_work, 1);
+        if (i >= nwork) return NULL;
+        restore_one(work[i]->rec);
+    }
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] <storage_path> [path...]\n", prog);
+    fprintf(stderr, "  -l          List matching versions instead of restoring\n");
+    fprintf(stderr, "  -t EPOCH    Restore the state at this time (default: latest version)\n");
+    fprintf(stderr, "  -V VERSION  Restore exactly this version\n");
+    fprintf(stderr, "  -i INODE    Only versions of this inode\n");
+    fprintf(stderr, "  -o OUTDIR   Restore under OUTDIR instead of in place\n");
+    fprintf(stderr, "  -j THREADS  Files restored in parallel (default: %d)\n", RESTORE_THREADS);
+}
+
+int main(int argc, char *argv[]) {
+    int c;
+    while ((c = getopt(argc, argv, "lt:V:i:o:j:")) != -1) {
+        switch (c) {
+        case 'l': opt.list = 1; break;
+        case 't': opt.at_time = atoll(optarg); break;
+        case 'V': opt.version = atoll(optarg); break;
+        case 'i': opt.inode = atoll(optarg); break;
+        case 'o': opt.outdir = optarg; break;
+        case 'j': opt.threads = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    opt.storage = realpath(argv[optind++], NULL);
+    if (!opt.storage) {
+        fprintf(stderr, "Invalid storage path: %s\n", argv[optind - 1]);
+        return 1;
+    }
+    snprintf(backup_dir, sizeof(backup_dir), "%s/%s", opt.storage, BACKUP_DIR);
+
+    // Selected paths are storage-relative; none means the whole tree
+    opt.nprefixes = argc - optind > 0 ? argc - optind : 1;
+    opt.prefixes = calloc(opt.nprefixes, sizeof(char *));
+    for (int i = 0; i < opt.nprefixes; i++) {
+        const char *p = optind < argc ? argv[optind + i] : "";
+        while (*p == '/') p++;
+        opt.prefixes[i] = malloc(PATH_MAX);
+        snprintf(opt.prefixes[i], PATH_MAX, "%s%s%s", opt.storage, *p ? "/" : "", p);
+        size_t n = strlen(opt.prefixes[i]);
+        while (n > 1 && opt.prefixes[i][n - 1] == '/') opt.prefixes[i][--n] = '\0';
+    }
+
+    if (chunk_store_init(backup_dir, 0) != 0 || backup_index_map(backup_dir, &index_map) != 0) {
+        fprintf(stderr, "No backup index in %s: %s\n", backup_dir, strerror(errno));
+        return 1;
+    }
+
+    size_t nrecords = 0;
+    for (const index_record_t *r = backup_index_next(&index_map, NULL); r;
+         r = backup_index_next(&index_map, r)) {
+        nrecords++;
+    }
+    deleted = calloc(nrecords + 1, sizeof(uint64_t));
+    for (const index_record_t *r = backup_index_next(&index_map, NULL); r;
+         r = backup_index_next(&index_map, r)) {
+        if (r->kind == INDEX_DELETED) deleted[ndeleted++] = r->version;
+    }
+    qsort(deleted, ndeleted, sizeof(uint64_t), cmp_u64);
+    size_t size = 16;
+    while (size < 2 * nrecords) size *= 2;
+    table = calloc(size, sizeof(entry_t));
+    work = calloc(nrecords + 1, sizeof(entry_t *));
+    table_mask = size - 1;
+
+    for (const index_record_t *r = backup_index_next(&index_map, NULL); r;
+         r = backup_index_next(&index_map, r)) {
+        if (!selected(r)) continue;
+        if (opt.list) {
+            print_record(r);
+        } else {
+            add_record(r);
+        }
+    }
+
+    if (!opt.list) {
+        int n = opt.threads < (int)nwork ? opt.threads : (int)nwork;
+        pthread_t threads[n > 0 ? n : 1];
+        for (int i = 0; i < n; i++) pthread_create(&threads[i], NULL, restore_worker, NULL);
+        for (int i = 0; i < n; i++) pthread_join(threads[i], NULL);
+        printf("%zu file(s) selected, %d failed\n", nwork, atomic_load(&failures));
+    }
+
+    backup_index_unmap(&index_map);
+    return atomic_load(&failures) ? 1 : 0;
+}